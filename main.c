@@ -1,6 +1,36 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_NUMA
+#include <numa.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_SIMD
+#include <immintrin.h>
+#endif
 
 
 #define TOKEN_DELIMITER "/"
@@ -8,6 +38,69 @@
 #define MAX_STDIN_LEN 255
 #define BUFFER_SIZE 8192
 #define NUMBER_BASE 10
+#define FOLD_BUFFER_SIZE 1024
+#define TRIGRAM_BITS 6
+#define TRIGRAM_SPACE (1 << (3 * TRIGRAM_BITS))
+#define SUGGEST_PROBE_LISTS 7
+#define SUGGEST_VERIFY_LIMIT 1024
+#define SUGGEST_POSTING_BUDGET 32768
+#define SUGGESTION_COUNT 10
+#define NEIGHBORHOOD_CHUNK 4096
+#define SEARCH_STOPPED -2
+#define SEARCH_CLOCK_INTERVAL 1024
+#define LOADER_CHUNK_SIZE (1 << 20)
+#define LOADER_READAHEAD (8 << 20)
+#define LOADER_QUEUE_SIZE 8
+#define LOADER_MAX_TOKENIZERS 8
+#define LOADER_BYTES_PER_BUCKET 64
+#define LOADER_COMPRESSION_RATIO 4
+#define INPUT_PLAIN 0
+#define INPUT_GZIP 1
+#define INPUT_ZSTD 2
+#define CACHE_LINE 64
+#define TOKENIZER_BLOCK 65536
+#define TOKENIZER_BENCH_SECONDS 0.25
+#define MAX_DELIMITER_SCANNERS 3
+#define ADJACENCY_MAGIC "BACONADJ"
+#define ADJACENCY_VERSION 1
+#define ADJACENCY_BLOCK_SIZE (4 << 20)
+#define ADJACENCY_ACTORS 0
+#define ADJACENCY_MOVIES 1
+#define ADJACENCY_NAMES 2
+#define ADJACENCY_SECTIONS 3
+#define UNREACHED 255
+#define PLACEMENT_DEFAULT 0
+#define PLACEMENT_INTERLEAVE 1
+#define PLACEMENT_REPLICATE 2
+#define BFS_STEAL_CHUNK 64
+#define BFS_QUEUE_SIZE 4096
+#define BFS_BENCH_RUNS 5
+#define BFS_BATCH 16
+#define COMPACT_IDS16 0
+#define COMPACT_IDS32 1
+#define RADIX_BUCKETS 33
+#define CENTRALITY_DELTA 0.05
+#define SELF_CHECK_ROUNDS 200
+#define SELF_CHECK_SOURCES 3
+#define SELF_CHECK_TARGETS 4
+#define SELF_CHECK_PATH_LIMIT 256
+#define SELF_CHECK_BLOCK_SIZE 256
+#define SELF_CHECK_TRIALS 2000
+#define SELF_CHECK_FAILURE_SIZE 1024
+#define SELF_CHECK_DIR "/tmp/bacon-check-XXXXXX"
+#define SHAPE_RANDOM 0
+#define SHAPE_HUB 1
+#define SHAPE_COMPONENTS 2
+#define SHAPE_DUPLICATES 3
+#define SHAPE_LONG_LINES 4
+#define SHAPE_NO_BACON 5
+#define SHAPE_CHAIN 6
+#define SHAPE_COUNT 7
+#define CENTRALITY_PROGRESS_SECONDS 1.0
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+#define BITSET_WORDS(n) (((n) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+#define BITSET_SET(b, i) ((b)[(i) / BITS_PER_WORD] |= 1UL << ((i) % BITS_PER_WORD))
+#define BITSET_TEST(b, i) (((b)[(i) / BITS_PER_WORD] >> ((i) % BITS_PER_WORD)) & 1UL)
 
 
 
@@ -22,14 +115,16 @@
  * @field name is the string holds name of the movie
  * @field actors is the string array holds name of the actors that plays in the movie
  * @field actor_count is the number of actors plays in the movie
- * @field is_visited holds boolean value about visiting information for BFS
+ * @field visited is the stamp of the last find_distance search that visited the movie
+ * @field id is the dense index of the movie in struct Graph
  */
 struct Movie
 {
     char *name;
     char **actors;
     int actor_count;
-    int is_visited;
+    unsigned int visited;
+    int id;
 };
 
 
@@ -44,18 +139,21 @@ struct Movie
  * @field name is the string holds name of the actor
  * @field movies is the string array holds name of the movies that actor plays
  * @field movie_count is the number of movie actor plays
- * @field is_visited holds boolean value about visiting information for BFS
- * @field parent_movie_name holds the movie name that this and parent Actor played together
+ * @field visited is the stamp of the last find_distance search that reached the actor, the parent
+ * fields are valid only while it is the stamp of the current search
+ * @field parent_movie_name points to the name of the movie that this and parent Actor played together
  * @field parent holds a pointer to lastly visited node on the graph
+ * @field id is the dense index of the actor in struct Graph
  */
 struct Actor
 {
     char *name;
     char **movies;
     int movie_count;
-    int is_visited;
+    unsigned int visited;
     char *parent_movie_name;
     struct Actor *parent;
+    int id;
 };
 
 
@@ -131,870 +229,10909 @@ struct QueueNode
 
 
 /**
- * Function prototypes
+ * @struct Graph
+ * @abstract an id based view of the actors and movies
+ *
+ * @discussion Graph interns every actor and movie to a dense integer id, so other modules can keep
+ * per node information in plain arrays instead of doing hash table lookups. Adjacency is stored in
+ * compressed rows: the movies of actor a are actor_movies[actor_offsets[a] .. actor_offsets[a + 1]),
+ * and the cast of movie m is movie_actors[movie_offsets[m] .. movie_offsets[m + 1]) in the order of
+ * the input line. Names are not copied, they point to the strings owned by Actor and Movie instances.
+ *
+ * @field actor_count is the number of actors
+ * @field movie_count is the number of movies
+ * @field actor_names is the array of actor names indexed by id
+ * @field movie_names is the array of movie names indexed by id
+ * @field actor_offsets is the beginning of each actor's row in actor_movies
+ * @field actor_movies holds movie ids of every actor
+ * @field movie_offsets is the beginning of each movie's row in movie_actors
+ * @field movie_actors holds actor ids of every movie
+ * @field movie_years is the release year of each movie, 0 when the name does not have a year
+ * @field actor_components is the connected component of each actor, two actors are connected only if
+ * their components are the same
+ * @field component_count is the number of connected components
  */
-char **read_file(char *path, int *line_count);
-
-char **parse_line(char *line);
-
-struct HashTable *create_hash_table(int m);
-
-struct Movie *create_movie(char *name);
+struct Graph
+{
+    int actor_count;
+    int movie_count;
+    char **actor_names;
+    char **movie_names;
+    int *actor_offsets;
+    int *actor_movies;
+    int *movie_offsets;
+    int *movie_actors;
+    short *movie_years;
+    int *actor_components;
+    int component_count;
+};
 
-struct Actor *create_actor(char *name);
 
-long hash(char *str);
+/**
+ * @struct SearchFilter
+ * @abstract constraints of a path query
+ *
+ * @discussion A filter limits which movies and actors a search may pass through. Excluded sets are
+ * bitsets indexed by id, so checking a node costs one memory access.
+ *
+ * @field min_year is the earliest allowed release year, 0 for no limit
+ * @field max_year is the latest allowed release year, 0 for no limit
+ * @field excluded_actors is the bitset of actors the path can not contain
+ * @field excluded_movies is the bitset of movies the path can not contain
+ */
+struct SearchFilter
+{
+    int min_year;
+    int max_year;
+    unsigned long *excluded_actors;
+    unsigned long *excluded_movies;
+};
 
-struct MapEntry *create_map_entry(long key, void *value);
 
-void build_hash_tables(char **lines, int line_count, struct HashTable *movies, struct HashTable *actors);
+/**
+ * @struct SearchContext
+ * @abstract preallocated state of the graph searches
+ *
+ * @discussion A search context holds every array a search needs, so a query does not allocate.
+ * Visiting information is kept as stamps: a node is visited in the current search if its stamp
+ * equals epoch, so starting a new search does not clear any array. Limits are kept between searches,
+ * a search that reaches one returns SEARCH_STOPPED and leaves a bound of its answer in lower_bound.
+ *
+ * @field graph is the graph to search on
+ * @field queue is the BFS queue of actor ids
+ * @field parent is the actor id each visited actor is reached from
+ * @field parent_movie is the movie id each visited actor is reached through
+ * @field actor_stamps is the visiting stamp of every actor
+ * @field movie_stamps is the visiting stamp of every movie
+ * @field epoch is the stamp value of the current search
+ * @field movie_queue is the queue of movie ids of level synchronous searches
+ * @field actor_level is the distance of each visited actor to the starting actor
+ * @field movie_level is the level of the actors each visited movie is reached from
+ * @field actor_paths is the number of shortest paths from the starting actor to each actor
+ * @field movie_paths is the number of shortest paths from the starting actor to each movie
+ * @field batch_movies is the movies of a batch of bfs_levels_prefetch, it grows as needed
+ * @field batch_movies_capacity is the size of batch_movies
+ * @field batch_cast is the cast entries of a batch of bfs_levels_prefetch, it grows as needed
+ * @field batch_cast_capacity is the size of batch_cast
+ * @field timeout is the time a search may take in seconds, 0 for no limit
+ * @field max_expanded is the number of actors a search may expand, 0 for no limit
+ * @field cancel stops the search when it is not 0, NULL for none
+ * @field deadline is the time the current search stops at, 0 for none
+ * @field expanded is the number of actors the current search expanded
+ * @field lower_bound is the bound of the answer of a stopped search
+ */
+struct SearchContext
+{
+    struct Graph *graph;
+    int *queue;
+    int *parent;
+    int *parent_movie;
+    unsigned int *actor_stamps;
+    unsigned int *movie_stamps;
+    unsigned int epoch;
+    int *movie_queue;
+    int *actor_level;
+    int *movie_level;
+    uint64_t *actor_paths;
+    uint64_t *movie_paths;
+    int *batch_movies;
+    long batch_movies_capacity;
+    int *batch_cast;
+    long batch_cast_capacity;
+    double timeout;
+    long max_expanded;
+    volatile sig_atomic_t *cancel;
+    double deadline;
+    long expanded;
+    long lower_bound;
+};
 
-void insert(struct HashTable *ht, long key, void *value);
 
-struct MapEntry *search(struct HashTable *ht, long key);
+/**
+ * @struct PathCursor
+ * @abstract an iterator over the shortest paths of a search
+ *
+ * @discussion A cursor walks the shortest path DAG left by count_shortest_paths from the ending actor
+ * back to the starting actor. The DAG is not stored: the predecessors of a node are its neighbours one
+ * level closer to the starting actor. Paths are visited in a fixed order, and path counts let the
+ * cursor jump to any path number without visiting the paths before it.
+ *
+ * @field ctx is the search context holds levels and path counts
+ * @field distance is the length of the paths
+ * @field actors holds the actors of the current path, actors[0] is the ending actor
+ * @field movies holds the movies of the current path, movies[i] links actors[i] and actors[i + 1]
+ * @field movie_pos is the position of movies[i] in the row of actors[i]
+ * @field actor_pos is the position of actors[i + 1] in the row of movies[i]
+ */
+struct PathCursor
+{
+    struct SearchContext *ctx;
+    int distance;
+    int *actors;
+    int *movies;
+    int *movie_pos;
+    int *actor_pos;
+};
 
-int find_bacon_number(char *start, struct HashTable *movies, struct HashTable *actors);
 
-int find_distance(char *start, char *end, struct HashTable *movies, struct HashTable *actors);
+/**
+ * @struct NameIndex
+ * @abstract an index for resolving misspelled or partial actor names
+ *
+ * @discussion NameIndex holds case and diacritic folded copies of the actor names. Folded names are
+ * sorted for prefix (autocomplete) lookups, and every trigram of a folded name has an inverted list of
+ * actor ids for typo tolerant suggestions. Scratch arrays are kept in the index, so queries do not
+ * allocate.
+ *
+ * @field name_count is the number of indexed names
+ * @field folded is the buffer holds every folded name, separated by NUL characters
+ * @field folded_offsets is the offset of each actor's folded name in the folded buffer
+ * @field sorted_ids is the array of actor ids sorted by folded names
+ * @field gram_offsets is the beginning of each trigram's list in gram_postings
+ * @field gram_postings holds the actor ids of every trigram list in ascending order
+ * @field stamps marks candidates of the current query
+ * @field hits is the number of probed lists a candidate appears in
+ * @field candidates is the candidate list of the current query
+ * @field order is the candidate list sorted by hits
+ * @field epoch is the stamp value of the current query
+ */
+struct NameIndex
+{
+    int name_count;
+    char *folded;
+    int *folded_offsets;
+    int *sorted_ids;
+    int *gram_offsets;
+    int *gram_postings;
+    unsigned int *stamps;
+    int *hits;
+    int *candidates;
+    int *order;
+    unsigned int epoch;
+};
 
-struct QueueNode* create_queue_node(void* value);
 
-struct Queue *create_queue();
+/**
+ * @struct FoldedKey
+ * @abstract a sort record for building the prefix index
+ *
+ * @field key is the folded name
+ * @field id is the actor id
+ */
+struct FoldedKey
+{
+    char *key;
+    int id;
+};
 
-void enqueue(struct Queue *q, void *value);
 
-void *dequeue(struct Queue *q);
+/**
+ * @struct LevelPrinter
+ * @abstract state of printing a neighborhood level by level
+ *
+ * @field graph is the graph holds actor names
+ * @field print_names is 1 to print names, 0 to print only counts
+ * @field last_level is the level of the last printed chunk
+ */
+struct LevelPrinter
+{
+    struct Graph *graph;
+    int print_names;
+    int last_level;
+};
 
 
 /**
- * Main entry point to program.
+ * @struct InputStream
+ * @abstract a plain or compressed input file
+ *
+ * @discussion InputStream reads a plain, gzip or zstd file as a stream of text. The format is
+ * detected from the first bytes of the file, so file names do not matter and nothing is seeked.
+ * Compressed bytes are read in LOADER_CHUNK_SIZE blocks and decompressed as the text is read.
+ *
+ * @field fd is the file descriptor
+ * @field format is one of INPUT_PLAIN, INPUT_GZIP and INPUT_ZSTD
+ * @field input is the buffer of bytes read from the file
+ * @field input_size is the number of bytes in input
+ * @field input_pos is the number of bytes of input already used
+ * @field bytes_read is the number of bytes read from the file
+ * @field error is set when the file can not be read or its compressed data is corrupt or truncated
+ * @field in_frame is set while a gzip member or zstd frame is not finished
+ * @field gz is the zlib state of gzip files
+ * @field zs is the zstd state of zstd files
  */
-int main()
+struct InputStream
 {
-    char path[MAX_STDIN_LEN];                           // File path
-    char input[MAX_STDIN_LEN];                          // User input from stdin
-    char start[MAX_STDIN_LEN];
-    char end[MAX_STDIN_LEN];
-    char *temp_str;
-    int line_count;                                     // Line count (a.k.a. movie count) of the file
-    int i;
-    int j;
-    int m;
-    int choice;
-    int result;
-    char **lines;
-    struct HashTable *movies;
-    struct HashTable *actors;
-    struct MapEntry *e;
-    struct Movie *movie;
-    struct Actor *actor;
+    int fd;
+    int format;
+    unsigned char *input;
+    long input_size;
+    long input_pos;
+    long bytes_read;
+    int error;
+    int in_frame;
+#ifdef HAVE_ZLIB
+    z_stream gz;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zs;
+#endif
+};
 
 
-    printf("\nPlease enter file path: \n");
-    printf("(Example: /home/mert/input-mpaa.txt)\n");
+/**
+ * @struct Chunk
+ * @abstract a block of whole input lines
+ *
+ * @discussion The loader reads the input file in chunks that end at a line end. Tokens are pointers
+ * into the chunk data, and movies keep their name tokens, so chunks are kept until the program ends.
+ *
+ * @field data is the NUL terminated text of the chunk
+ * @field size is the number of bytes in data
+ * @field tokens holds the tokens of every line, each line is terminated with NULL
+ * @field token_count is the number of entries in tokens, NULL entries included
+ * @field record_count is the number of lines with tokens
+ * @field next is the pointer to next chunk
+ */
+struct Chunk
+{
+    char *data;
+    long size;
+    char **tokens;
+    long token_count;
+    long record_count;
+    struct Chunk *next;
+};
 
-    fscanf(stdin, "%s", path);
 
-    lines = read_file(path, &line_count);               // Read line by line
-    m = line_count;                                     // m is the hash table size
+/**
+ * @struct DelimiterScanner
+ * @abstract a kernel that finds field and line delimiters
+ *
+ * @discussion Kernels differ only in the instruction set they use, every kernel gives the same
+ * offsets. The fastest one the CPU supports is chosen when the program runs.
+ *
+ * @field name is the name of the instruction set
+ * @field scan writes the offset of every '/' and '\n' of a block in order, and returns their
+ * number, the offsets array must have room for size entries
+ */
+struct DelimiterScanner
+{
+    char *name;
+    long (*scan)(const char *data, long size, uint32_t *offsets);
+};
 
-    movies = create_hash_table(m);
-    actors = create_hash_table(m);
 
-    build_hash_tables(lines, line_count, movies, actors);
+/**
+ * @struct RingQueue
+ * @abstract a bounded single producer, single consumer queue
+ *
+ * @discussion RingQueue connects two loader stages without locks. Only the producer writes tail and
+ * only the consumer writes head, so publishing an element needs only a release store. head and tail
+ * are on separate cache lines.
+ *
+ * @field slots is the array of elements
+ * @field mask is the capacity minus one, capacity is a power of two
+ * @field head is the number of popped elements
+ * @field tail is the number of pushed elements
+ */
+struct RingQueue
+{
+    void *slots[LOADER_QUEUE_SIZE];
+    unsigned long mask;
+    char head_line[CACHE_LINE];
+    unsigned long head;
+    char tail_line[CACHE_LINE];
+    unsigned long tail;
+};
 
-    do
-    {
-        printf("Please enter your operation type: \n");
-        printf("1. Find Bacon Number (Distance of an actor to Kevin Bacon)\n");
-        printf("2. Find Distance (Distance of two actors)\n");
 
-        scanf("%s", input);
-        choice = strtol(input, &temp_str, NUMBER_BASE);
-        getchar();
+/**
+ * @struct StageStats
+ * @abstract throughput information of a loader stage
+ *
+ * @field items is the number of chunks or records the stage produced
+ * @field bytes is the number of bytes the stage processed
+ * @field busy is the time the stage worked, in seconds
+ * @field stalled is the time the stage waited for its input or output queue, in seconds
+ */
+struct StageStats
+{
+    long items;
+    long bytes;
+    double busy;
+    double stalled;
+};
 
-        printf("Please enter valid input\n");
-        printf("Example: Bacon, Kevin\n");
 
-        if (choice == 1)
-        {
-            printf("Please enter an actor name: \n");
-            scanf("%[^\n]s", start);
-            getchar();
+/**
+ * @struct TokenizerStage
+ * @abstract a tokenizer worker of the loader
+ *
+ * @field input is the queue of chunks from the reader
+ * @field output is the queue of tokenized chunks to the builder
+ * @field stats is the statistics of the worker
+ * @field scanner is the delimiter scanner of the worker
+ * @field thread is the worker thread
+ */
+struct TokenizerStage
+{
+    struct RingQueue input;
+    struct RingQueue output;
+    struct StageStats stats;
+    struct DelimiterScanner scanner;
+    pthread_t thread;
+};
 
-            result = find_bacon_number(start, movies, actors);
 
-            if (result == -1)
-            {
-                printf("Invalid input(s) or no connection\n");
-            }
-            else
-            {
-                printf("Bacon Number: %d\n", result);
-            }
-        }
-        else if (choice == 2)
-        {
-            printf("Please enter first actor name: \n");
-            scanf("%[^\n]s", start);
-            getchar();
+/**
+ * @struct Pipeline
+ * @abstract the state of a pipelined load
+ *
+ * @discussion A reader thread reads chunks and deals them to tokenizer workers in turn, and the
+ * builder takes tokenized chunks from the workers in the same turn, so lines are built in file
+ * order however many workers run.
+ *
+ * @field input is the input file
+ * @field worker_count is the number of tokenizer workers
+ * @field workers is the array of tokenizer workers
+ * @field reader is the statistics of the reader
+ */
+struct Pipeline
+{
+    struct InputStream *input;
+    int worker_count;
+    struct TokenizerStage workers[LOADER_MAX_TOKENIZERS];
+    struct StageStats reader;
+};
 
-            printf("Please enter second actor name: \n");
-            scanf("%[^\n]s", end);
-            getchar();
 
-            result = find_distance(start, end, movies, actors);
+/**
+ * @struct LoadStats
+ * @abstract statistics of a pipelined load
+ *
+ * @field reader is the statistics of the reader stage
+ * @field tokenizer is the sum of statistics of tokenizer workers
+ * @field builder is the statistics of the builder stage
+ * @field tokenizer_count is the number of tokenizer workers
+ * @field elapsed is the wall clock time of the load, in seconds
+ * @field format is the format of the input file
+ * @field file_bytes is the number of bytes read from the file, compressed size for compressed files
+ */
+struct LoadStats
+{
+    struct StageStats reader;
+    struct StageStats tokenizer;
+    struct StageStats builder;
+    int tokenizer_count;
+    double elapsed;
+    int format;
+    long file_bytes;
+};
 
-            if (result == -1)
-            {
-                printf("Invalid input(s) or no connection\n");
-            }
-            else
-            {
-                printf("Distance: %d\n", result);
-            }
-        }
-        else
-        {
-            printf("Invalid choice\n");
-        }
-    } while (choice == 0);
 
-    /** Free hash tables */
-    for (i = 0; i < m; i++)
-    {
-        e = movies[i].head;
+/**
+ * @struct AdjacencyHeader
+ * @abstract the header of an adjacency file
+ *
+ * @discussion An adjacency file holds a graph for out of core queries. It has three sections: the
+ * actor rows, the movie rows and the actor names, all in id order. A row is its length as uint32_t
+ * followed by the ids of the row as uint32_t, and a name is a NUL terminated string. Sections are
+ * cut into blocks of whole records of about block_bytes, and a block index of each section is at
+ * the end of the file.
+ *
+ * @field magic is ADJACENCY_MAGIC without its NUL
+ * @field version is ADJACENCY_VERSION
+ * @field block_bytes is the size blocks were cut at
+ * @field actor_count is the number of actors
+ * @field movie_count is the number of movies
+ * @field max_block is the size of the largest block
+ * @field section_offset is the file offset of each section
+ * @field section_bytes is the size of each section
+ * @field index_offset is the file offset of the block index of each section
+ * @field block_count is the number of blocks of each section
+ */
+struct AdjacencyHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t block_bytes;
+    int64_t actor_count;
+    int64_t movie_count;
+    int64_t max_block;
+    int64_t section_offset[ADJACENCY_SECTIONS];
+    int64_t section_bytes[ADJACENCY_SECTIONS];
+    int64_t index_offset[ADJACENCY_SECTIONS];
+    int64_t block_count[ADJACENCY_SECTIONS];
+};
 
-        while (e != NULL)
-        {
-            movie =  e->value;
-            for (j = 0; j < movie->actor_count; j++)
-            {
-                free(movie->actors[j]);
-            }
 
-            free(movie->actors);
-            free(movie);
+/**
+ * @struct AdjacencyBlock
+ * @abstract an entry of the block index of an adjacency file
+ *
+ * @field offset is the file offset of the block
+ * @field size is the size of the block in bytes
+ * @field first is the id of the first record of the block
+ * @field count is the number of records in the block
+ */
+struct AdjacencyBlock
+{
+    int64_t offset;
+    int64_t size;
+    int32_t first;
+    int32_t count;
+};
 
-            e = e->next;
-        }
 
-        e = actors[i].head;
+/**
+ * @struct ExternalGraph
+ * @abstract an adjacency file opened for out of core queries
+ *
+ * @discussion Only the header, the block indexes and one block buffer are in memory. Blocks are read
+ * with plain sequential reads, and the counters tell how much of the file a query needed.
+ *
+ * @field fd is the file descriptor of the adjacency file
+ * @field header is the header of the file
+ * @field blocks is the block index of each section
+ * @field buffer holds the block being read, it has room for the largest block
+ * @field passes is the number of section scans that read at least one block
+ * @field blocks_read is the number of blocks read
+ * @field blocks_skipped is the number of blocks a scan did not need
+ * @field bytes_read is the number of bytes read
+ * @field saturated is set when the last sweep reached actors farther than a distance byte holds
+ */
+struct ExternalGraph
+{
+    int fd;
+    struct AdjacencyHeader header;
+    struct AdjacencyBlock *blocks[ADJACENCY_SECTIONS];
+    char *buffer;
+    long passes;
+    long blocks_read;
+    long blocks_skipped;
+    long bytes_read;
+    int saturated;
+};
 
-        while (e != NULL)
-        {
-            actor = e->value;
 
-            for (j = 0; j < actor->movie_count; j++)
-            {
-                free(actor->movies[j]);
-            }
+/**
+ * @struct Topology
+ * @abstract the CPUs a process may run on and their NUMA nodes
+ *
+ * @discussion Without libnuma, or when the kernel has no NUMA support, every CPU is on node 0.
+ *
+ * @field cpu_count is the number of CPUs
+ * @field node_count is the number of NUMA nodes with at least one of the CPUs
+ * @field cpus is the CPU numbers, ordered so that consecutive entries are on different nodes
+ * @field nodes is the node of each entry of cpus
+ */
+struct Topology
+{
+    int cpu_count;
+    int node_count;
+    int *cpus;
+    int *nodes;
+};
 
-            free(actor->movies);
-            free(actor);
 
-            e = e->next;
-        }
-    }
+/**
+ * @struct GraphReplica
+ * @abstract the adjacency arrays a traversal reads
+ *
+ * @discussion A replica either points to the arrays of struct Graph or owns copies placed with
+ * libnuma, then size holds the bytes of each array to free them.
+ *
+ * @field actor_offsets is the beginning of each actor's row in actor_movies
+ * @field actor_movies holds movie ids of every actor
+ * @field movie_offsets is the beginning of each movie's row in movie_actors
+ * @field movie_actors holds actor ids of every movie
+ * @field size is the size of each array in bytes when the replica owns them, 0 otherwise
+ */
+struct GraphReplica
+{
+    int *actor_offsets;
+    int *actor_movies;
+    int *movie_offsets;
+    int *movie_actors;
+    size_t size[4];
+};
 
-    free(movies);
-    free(actors);
 
-    /** Free lines */
-    for (i = 0; i < line_count; i++)
-    {
-        free(lines[i]);
-    }
+/**
+ * @struct FrontierQueue
+ * @abstract the actors a worker found in a level
+ *
+ * @discussion A queue is filled only by its worker, and is first touched by it, so its pages are on
+ * the worker's node. In the next level every worker takes chunks from it by moving taken forward,
+ * the owner first.
+ *
+ * @field items is the array of actor ids
+ * @field size is the number of actor ids
+ * @field capacity is the size of items
+ * @field taken is the number of items given to workers, on its own cache line
+ */
+struct FrontierQueue
+{
+    int *items;
+    long size;
+    long capacity;
+    char taken_line[CACHE_LINE];
+    long taken;
+    char end_line[CACHE_LINE];
+};
 
-    free(lines);
 
-    return 0;
-}
+/**
+ * @struct BfsWorker
+ * @abstract a thread of the parallel BFS
+ *
+ * @field bfs is the parallel BFS the worker belongs to
+ * @field index is the index of the worker
+ * @field cpu is the CPU the worker is pinned to, -1 if it is not pinned
+ * @field node is the NUMA node of the worker
+ * @field queues is the frontier of the current and the next level
+ * @field thread is the worker thread
+ */
+struct BfsWorker
+{
+    struct ParallelBfs *bfs;
+    int index;
+    int cpu;
+    int node;
+    struct FrontierQueue queues[2];
+    pthread_t thread;
+};
 
 
 /**
- * @function read_file
- *
- * @brief Read lines from file
+ * @struct ParallelBfs
+ * @abstract a multi-threaded level synchronous BFS
  *
- * @discussion
- * <p>This function reads lines and returns a pointer to array of lines.
+ * @discussion Workers expand the frontier together and claim movies and actors with atomic
+ * operations, so every node is expanded once. Levels are separated with a barrier. Workers are
+ * started with the instance and wait between searches, so a search does not create threads. How the
+ * adjacency arrays are placed on NUMA nodes is chosen when the instance is created:
+ * PLACEMENT_DEFAULT reads the arrays of struct Graph where they are, PLACEMENT_INTERLEAVE copies them
+ * to pages spread over all nodes, and PLACEMENT_REPLICATE gives every node its own copy. On a single
+ * node machine or without libnuma every placement reads the arrays of struct Graph.
  *
- * @param path is the file path
- * @param line_count is the file's line count
- * @return array of string (lines)
+ * @field graph is the graph to search on
+ * @field placement is the placement of the adjacency arrays
+ * @field pin is 1 if workers are pinned to CPUs
+ * @field worker_count is the number of workers
+ * @field topology is the CPUs and nodes of the machine
+ * @field replicas is the adjacency arrays of each node, one entry unless replicated
+ * @field replica_count is the number of replicas
+ * @field actor_level is the distance of each actor to the starting actor, -1 if not reached
+ * @field movie_seen is 1 for every movie claimed by a worker
+ * @field placed_state is 1 if actor_level and movie_seen are interleaved with libnuma
+ * @field workers is the array of workers
+ * @field barrier separates levels
+ * @field pool lets the calling thread start a search and wait for its end
+ * @field stop is 1 when the workers must exit
+ * @field current is the index of the queues of the current level
+ * @field level is the current level
+ * @field done is 1 when the last level is found
+ * @field reached is the number of actors reached
  */
-char **read_file(char *path, int *line_count)
+struct ParallelBfs
 {
-    FILE *fptr;
-    int j;
-    int tmp;
-    char **lines;
-    char line[BUFFER_SIZE];
+    struct Graph *graph;
+    int placement;
+    int pin;
+    int worker_count;
+    struct Topology topology;
+    struct GraphReplica *replicas;
+    int replica_count;
+    int *actor_level;
+    unsigned char *movie_seen;
+    int placed_state;
+    struct BfsWorker *workers;
+    pthread_barrier_t barrier;
+    pthread_barrier_t pool;
+    int stop;
+    int current;
+    int level;
+    int done;
+    long reached;
+};
 
-    fptr = fopen(path, "r");
-    *line_count = 0;
 
-    while (!feof(fptr))
-    {
-        tmp = fgetc(fptr);
-        if (tmp == '\n')
-        {
-            (*line_count)++;
-        }
-    }
+/**
+ * @struct RadixHeap
+ * @abstract a monotone priority queue of integer keys
+ *
+ * @discussion Dijkstra never pushes a key smaller than the last popped one, so a radix heap can
+ * keep entries in buckets by the highest bit their key differs from the last popped key. Bucket 0
+ * holds keys equal to it. When bucket 0 is empty, the first non empty bucket is spread into lower
+ * buckets around its smallest key, and an entry moves at most 32 times in total. Keys are not
+ * decreased, a better key is pushed again and the stale entry is skipped by the caller.
+ *
+ * @field last is the last popped key
+ * @field size is the number of entries
+ * @field keys is the keys of each bucket
+ * @field values is the values of each bucket
+ * @field counts is the number of entries of each bucket
+ * @field capacities is the size of the arrays of each bucket
+ */
+struct RadixHeap
+{
+    uint32_t last;
+    long size;
+    uint32_t *keys[RADIX_BUCKETS];
+    int *values[RADIX_BUCKETS];
+    long counts[RADIX_BUCKETS];
+    long capacities[RADIX_BUCKETS];
+};
 
-    rewind(fptr);
-    (*line_count)++;
 
-    lines = malloc(*line_count * sizeof(char*));
-    for (j = 0; j < *line_count; j++)
-    {
-        lines[j] = malloc(BUFFER_SIZE * sizeof(char));
-    }
+/**
+ * @struct WeightedGraph
+ * @abstract hop costs of the strongest connection search
+ *
+ * @discussion An actor - movie - actor hop costs cast_cost(movie) + billing_cost(first actor) +
+ * billing_cost(second actor). cast_cost is 1 + log2 of the cast size, so a two hander costs 2 and a
+ * 3000 person epic costs 12. billing_cost is log2 of the position in the movie line plus one, so
+ * the first credited actor costs 0 and the 4th to 7th cost 2. The first two terms are stored for
+ * every edge of actor rows, the third is computed from the position in the movie row.
+ *
+ * @field graph is the graph to search on
+ * @field actor_costs is the cost of every entry of actor_movies
+ * @field actor_dist is the cost of the best known path to each actor
+ * @field movie_dist is the cost of the best known path to each movie
+ * @field movie_parent is the actor each movie is reached from
+ * @field heap is the priority queue of the search, actors are ids and movies are actor_count + id
+ */
+struct WeightedGraph
+{
+    struct Graph *graph;
+    unsigned char *actor_costs;
+    uint32_t *actor_dist;
+    uint32_t *movie_dist;
+    int *movie_parent;
+    struct RadixHeap heap;
+};
 
-    j = 0;
 
-    while (fgets(line, BUFFER_SIZE- 1, fptr) != NULL)
-    {
-        int i = 0;
-        while ((line[i] != '\n')) i++;
-        memcpy(lines[j++], line, i);
+/**
+ * @struct CentralityResult
+ * @abstract betweenness and closeness of every actor
+ *
+ * @discussion Shortest paths are actor - movie - actor chains, and two chains through different
+ * movies are different paths, like in count_shortest_paths. Only actors are path ends. When sources
+ * are sampled, betweenness is scaled to estimate the exact value, and with probability 1 - delta
+ * every normalized betweenness is within epsilon of the exact one.
+ *
+ * @field betweenness is the number of shortest paths between other actors an actor is on, split
+ * evenly between the shortest paths of every pair
+ * @field closeness is the reached fraction of sources divided by the average distance to them
+ * @field sources is the number of BFS sources
+ * @field seed is the seed of the sample
+ * @field exact is 1 if every actor is a source
+ * @field epsilon is the error bound of normalized betweenness when sources are sampled
+ * @field delta is the probability the error bound does not hold
+ * @field elapsed is the time of the computation, in seconds
+ */
+struct CentralityResult
+{
+    double *betweenness;
+    double *closeness;
+    long sources;
+    uint64_t seed;
+    int exact;
+    double epsilon;
+    double delta;
+    double elapsed;
+};
+
+
+/**
+ * @struct CentralityWorker
+ * @abstract a thread of the centrality computation
+ *
+ * @discussion Nodes are actors and movies, actor a is node a and movie m is node actor_count + m.
+ * The search arrays are reset after every source only where they were written.
+ *
+ * @field job is the computation the worker belongs to
+ * @field dist is the distance of each node to the source, -1 if not reached
+ * @field sigma is the number of shortest paths from the source to each node
+ * @field delta is the dependency of the source on each node
+ * @field order is the nodes in the order they are reached
+ * @field betweenness is the betweenness sum of the worker
+ * @field farness is the distance sum of every actor to the sources of the worker
+ * @field reached is the number of sources of the worker that reached every actor
+ * @field thread is the worker thread
+ */
+struct CentralityWorker
+{
+    struct CentralityJob *job;
+    int *dist;
+    double *sigma;
+    double *delta;
+    int *order;
+    double *betweenness;
+    double *farness;
+    int *reached;
+    pthread_t thread;
+};
+
+
+/**
+ * @struct CentralityJob
+ * @abstract the shared state of a centrality computation
+ *
+ * @field graph is the graph
+ * @field sources is the array of source actors
+ * @field source_count is the number of sources
+ * @field next is the index of the next source to take
+ * @field done is the number of finished sources
+ */
+struct CentralityJob
+{
+    struct Graph *graph;
+    int *sources;
+    long source_count;
+    long next;
+    long done;
+};
+
+
+/**
+ * @define COMPACT_GRAPH_TYPE
+ * @abstract declares an adjacency struct with fixed id and offset widths
+ *
+ * @discussion Rows are the same as in struct Graph, only the integer types differ. Ids are actor
+ * and movie ids, offsets index the id arrays. The kernels of a type are made by
+ * COMPACT_GRAPH_KERNELS with the same arguments, so their loops are compiled for one width.
+ *
+ * @field actor_offsets is the beginning of each actor's row in actor_movies
+ * @field actor_movies holds movie ids of every actor
+ * @field movie_offsets is the beginning of each movie's row in movie_actors
+ * @field movie_actors holds actor ids of every movie
+ * @field queue is the BFS queue of actor ids
+ */
+#define COMPACT_GRAPH_TYPE(name, id_type, offset_type) \
+struct name \
+{ \
+    offset_type *actor_offsets; \
+    id_type *actor_movies; \
+    offset_type *movie_offsets; \
+    id_type *movie_actors; \
+    id_type *queue; \
+}
+
+COMPACT_GRAPH_TYPE(CompactGraph16, uint16_t, uint32_t);
+COMPACT_GRAPH_TYPE(CompactGraph32, uint32_t, uint32_t);
+
+
+/**
+ * @struct CompactGraph
+ * @abstract the smallest adjacency layout a dataset fits in
+ *
+ * @discussion The variant is chosen from the actor and movie counts when the graph is copied: 16 bit
+ * ids when every id fits, 32 bit ids otherwise. Offsets are 32 bits, the int offsets of struct Graph
+ * always fit. Distances are bytes, a search saturates them at UNREACHED - 1. Searches switch on the
+ * variant once and run a kernel compiled for its widths. The copy is made only by benchmark_bfs and
+ * the self check, the distance, path and neighborhood searches of the program run on struct Graph.
+ *
+ * @field variant is COMPACT_IDS16 or COMPACT_IDS32
+ * @field actor_count is the number of actors
+ * @field movie_count is the number of movies
+ * @field bytes is the size of the adjacency arrays, the queue and the distances
+ * @field distance is the distance of each actor to the starting actor of the last search, UNREACHED
+ * if not reached
+ * @field movie_seen is the bitset of movies reached by the last search
+ * @field graph is the adjacency arrays of the variant
+ */
+struct CompactGraph
+{
+    int variant;
+    int actor_count;
+    int movie_count;
+    long bytes;
+    unsigned char *distance;
+    unsigned long *movie_seen;
+    union
+    {
+        struct CompactGraph16 ids16;
+        struct CompactGraph32 ids32;
+    } graph;
+};
+
+
+/**
+ * @struct CheckCase
+ * @abstract a generated input file of the self check
+ *
+ * @discussion A case is kept as ids and names are made from ids when the file is written, so lines and
+ * cast entries can be removed while a failure is minimized. Extra delimiters and blank lines are
+ * chosen from format_seed when the file is written.
+ *
+ * @field line_count is the number of movie lines
+ * @field line_capacity is the size of titles and line_offsets
+ * @field titles is the title id of each line, lines can share a title
+ * @field line_offsets is the beginning of each line's cast in cast
+ * @field cast holds actor ids of every line, an actor can be written twice in a line
+ * @field cast_capacity is the size of cast
+ * @field actor_count is the number of actor ids, some of them may not be in any line
+ * @field title_count is the number of title ids
+ * @field name_padding is the number of characters added to every actor name
+ * @field has_bacon is 1 if actor 0 is named Bacon, Kevin
+ * @field format_seed is the seed of the extra delimiters and blank lines
+ */
+struct CheckCase
+{
+    int line_count;
+    int line_capacity;
+    int *titles;
+    int *line_offsets;
+    int *cast;
+    int cast_capacity;
+    int actor_count;
+    int title_count;
+    int name_padding;
+    int has_bacon;
+    uint64_t format_seed;
+};
+
+
+/**
+ * @struct CheckReference
+ * @abstract the reference BFS of the self check
+ *
+ * @discussion The reference reads the case, not the loaded tables, so loader bugs are found as well as
+ * search bugs. Ids are the ids of the case. Actor ids go up to actor_count: that last name is never
+ * written to the file and is used to query a missing actor.
+ *
+ * @field c is the case
+ * @field names is the name of every actor id
+ * @field titles is the name of every title id
+ * @field actor_keys is the actor names sorted
+ * @field title_keys is the title names sorted
+ * @field present is the number of cast entries of every actor
+ * @field actor_offsets is the beginning of each actor's row in actor_lines
+ * @field actor_lines holds the lines of every actor
+ * @field level is the distance of each actor to the starting actor, -1 if not reached
+ * @field paths is the number of shortest paths from the starting actor to each actor
+ * @field marks is the stamp of each actor, to count an actor once per line
+ * @field mark is the current actor stamp
+ * @field line_stamps is the stamp of each line expanded by the current search
+ * @field epoch is the current line stamp
+ * @field queue is the BFS queue of actors
+ * @field line_queue is the lines of the current level
+ * @field positions is the billing position of every cast entry, an actor written twice keeps its first
+ * @field line_sizes is the number of different actors of every line
+ * @field actor_positions is the billing position of every entry of actor_lines
+ * @field cost is the cost of the cheapest chain from the starting actor to each actor, -1 if not reached
+ * @field line_cost is the cheapest cost of entering each line
+ * @field heap_keys is the keys of the Dijkstra heap
+ * @field heap_nodes is the actors and lines of the Dijkstra heap, lines follow the actors
+ * @field heap_size is the number of heap entries
+ */
+struct CheckReference
+{
+    struct CheckCase *c;
+    char **names;
+    char **titles;
+    struct FoldedKey *actor_keys;
+    struct FoldedKey *title_keys;
+    int *present;
+    int *actor_offsets;
+    int *actor_lines;
+    int *level;
+    uint64_t *paths;
+    int *marks;
+    int mark;
+    int *line_stamps;
+    int epoch;
+    int *queue;
+    int *line_queue;
+    int *positions;
+    int *line_sizes;
+    int *actor_positions;
+    long *cost;
+    long *line_cost;
+    long *heap_keys;
+    int *heap_nodes;
+    int heap_size;
+};
+
+
+/**
+ * @struct CheckEngines
+ * @abstract every engine of the self check on one loaded file
+ *
+ * @field label is the name of the loader path
+ * @field movies is the movies hash table
+ * @field actors is the actors hash table
+ * @field chunks is the chunks of the loaded file
+ * @field g is the graph
+ * @field ctx is the search context
+ * @field compact is the compact graph
+ * @field parallel is the parallel BFS
+ * @field weighted is the weighted graph
+ * @field external is the adjacency file of the graph
+ * @field ids is the graph id of every case actor, -1 if not loaded
+ * @field expected is the reference distance of every graph actor
+ * @field found is the distance of every graph actor found by an engine
+ */
+struct CheckEngines
+{
+    char *label;
+    struct HashTable *movies;
+    struct HashTable *actors;
+    struct Chunk *chunks;
+    struct Graph *g;
+    struct SearchContext *ctx;
+    struct CompactGraph *compact;
+    struct ParallelBfs *parallel;
+    struct WeightedGraph *weighted;
+    struct ExternalGraph *external;
+    int *ids;
+    int *expected;
+    int *found;
+};
+
+
+/**
+ * Function prototypes
+ */
+char **parse_line(char *line);
+
+struct HashTable *create_hash_table(int m);
+
+struct Movie *create_movie(char *name);
+
+struct Actor *create_actor(char *name);
+
+long hash(char *str);
+
+struct MapEntry *create_map_entry(long key, void *value);
+
+void add_movie(char **tokens, struct HashTable *movies, struct HashTable *actors);
+
+void insert(struct HashTable *ht, long key, void *value);
+
+struct MapEntry *search(struct HashTable *ht, long key);
+
+void free_hash_tables(struct HashTable *movies, struct HashTable *actors);
+
+int find_bacon_number(char *start, struct HashTable *movies, struct HashTable *actors);
+
+int find_distance(char *start, char *end, struct HashTable *movies, struct HashTable *actors);
+
+struct QueueNode* create_queue_node(void* value);
+
+struct Queue *create_queue();
+
+void enqueue(struct Queue *q, void *value);
+
+void *dequeue(struct Queue *q);
+
+double now_seconds(void);
+
+struct Graph *build_graph(struct HashTable *movies, struct HashTable *actors);
+
+int parse_movie_year(char *name);
+
+void free_graph(struct Graph *g);
+
+int fold_name(char *src, char *dst, int size);
+
+int name_trigrams(char *folded, int *grams);
+
+struct NameIndex *build_name_index(struct Graph *g);
+
+void free_name_index(struct NameIndex *index);
+
+int complete_name(struct NameIndex *index, char *prefix, int *ids, int k);
+
+int suggest_names(struct NameIndex *index, char *query, int *ids, double *scores, int k);
+
+void print_suggestions(struct NameIndex *index, struct Graph *g, char *name);
+
+struct SearchFilter *create_search_filter(struct Graph *g);
+
+void free_search_filter(struct SearchFilter *f);
+
+struct SearchContext *create_search_context(struct Graph *g);
+
+void free_search_context(struct SearchContext *ctx);
+
+void begin_search(struct SearchContext *ctx);
+
+void set_search_limits(struct SearchContext *ctx, double timeout, long max_expanded, volatile sig_atomic_t *cancel);
+
+int find_distance_filtered(struct SearchContext *ctx, int start, int end, struct SearchFilter *filter);
+
+void print_path(struct SearchContext *ctx, int end);
+
+int count_shortest_paths(struct SearchContext *ctx, int start, int end, struct SearchFilter *filter,
+                         uint64_t *count);
+
+struct PathCursor *create_path_cursor(struct SearchContext *ctx, int end, int distance);
+
+void free_path_cursor(struct PathCursor *c);
+
+int path_cursor_seek(struct PathCursor *c, uint64_t number);
+
+int path_cursor_next(struct PathCursor *c);
+
+void print_cursor_path(struct PathCursor *c);
+
+void sort_by_degree(struct Graph *g, int *ids, int n);
+
+int expand_neighborhood(struct SearchContext *ctx, int start, int depth, struct SearchFilter *filter,
+                        int sorted, void (*visit)(int level, int level_size, int *ids, int count, void *data),
+                        void *data);
+
+void print_level(int level, int level_size, int *ids, int count, void *data);
+
+struct InputStream *open_input_stream(char *path);
+
+long read_input(struct InputStream *in, char *buffer, long size);
+
+void close_input_stream(struct InputStream *in);
+
+void ring_init(struct RingQueue *q);
+
+void ring_push(struct RingQueue *q, void *value, struct StageStats *stats);
+
+void *ring_pop(struct RingQueue *q, struct StageStats *stats);
+
+void *read_chunks(void *arg);
+
+int delimiter_scanners(struct DelimiterScanner *scanners);
+
+void tokenize_chunk(struct Chunk *chunk, struct DelimiterScanner *scanner);
+
+void *tokenize_chunks(void *arg);
+
+int load_file(char *path, struct HashTable **movies, struct HashTable **actors, struct Chunk **chunks,
+              struct LoadStats *stats);
+
+void free_chunks(struct Chunk *chunks);
+
+void print_load_stats(struct LoadStats *stats);
+
+void benchmark_tokenizer(char *path);
+
+int write_adjacency_file(struct Graph *g, char *path, long block_bytes);
+
+struct ExternalGraph *open_external_graph(char *path, int *corrupt);
+
+void close_external_graph(struct ExternalGraph *eg);
+
+int external_find_actor(struct ExternalGraph *eg, char *name);
+
+int external_bacon_sweep(struct ExternalGraph *eg, int start, long *histogram);
+
+void print_external_sweep(struct ExternalGraph *eg, long *histogram, int levels, double elapsed);
+
+void detect_topology(struct Topology *t);
+
+struct ParallelBfs *create_parallel_bfs(struct Graph *g, int threads, int placement, int pin);
+
+void free_parallel_bfs(struct ParallelBfs *bfs);
+
+long parallel_bfs(struct ParallelBfs *bfs, int start);
+
+int bfs_levels(struct SearchContext *ctx, int start);
+
+int bfs_levels_prefetch(struct SearchContext *ctx, int start);
+
+void benchmark_bfs(struct SearchContext *ctx, int start, int threads);
+
+struct CompactGraph *build_compact_graph(struct Graph *g);
+
+void free_compact_graph(struct CompactGraph *c);
+
+long compact_bfs(struct CompactGraph *c, int start);
+
+char *compact_variant_name(struct CompactGraph *c);
+
+void radix_heap_push(struct RadixHeap *h, uint32_t key, int value);
+
+int radix_heap_pop(struct RadixHeap *h, uint32_t *key);
+
+void radix_heap_clear(struct RadixHeap *h);
+
+struct WeightedGraph *create_weighted_graph(struct Graph *g);
+
+void free_weighted_graph(struct WeightedGraph *w);
+
+long find_strongest_link(struct WeightedGraph *w, struct SearchContext *ctx, int start, int end, int *hops);
+
+struct CentralityResult *compute_centrality(struct Graph *g, double epsilon, int threads, uint64_t seed);
+
+void free_centrality(struct CentralityResult *r);
+
+void print_top_centrality(struct Graph *g, struct CentralityResult *r, int k);
+
+struct CheckCase *generate_check_case(uint64_t *seed, int shape);
+
+void free_check_case(struct CheckCase *c);
+
+int write_check_case(struct CheckCase *c, struct CheckReference *ref, char *path, int format);
+
+struct CheckReference *create_check_reference(struct CheckCase *c);
+
+void free_check_reference(struct CheckReference *ref);
+
+void reference_bfs(struct CheckReference *ref, int start);
+
+void reference_dijkstra(struct CheckReference *ref, int start);
+
+int check_case(struct CheckCase *c, char *dir, int *queries, int query_count, char *failure);
+
+struct CheckCase *minimize_check_case(struct CheckCase *c, char *dir, int *queries, int query_count, char *first);
+
+int self_check(int rounds, uint64_t seed);
+
+int read_line(char *buffer, int size);
+
+int find_actor_id(struct HashTable *actors, char *name);
+
+int find_movie_id(struct HashTable *movies, char *name);
+
+void read_exclusions(char *list, struct HashTable *ht, int is_movie_table, unsigned long *set);
+
+
+/**
+ * Set by SIGINT to stop the running search
+ */
+static volatile sig_atomic_t interrupt_requested;
+
+/**
+ * Set by main while a menu query runs
+ */
+static volatile sig_atomic_t query_running;
+
+
+/**
+ * @function request_interrupt
+ *
+ * @brief SIGINT handler, asks the running search to stop
+ *
+ * @discussion
+ * <p>At the menu the signal is ignored. A second signal while the query is still stopping ends the
+ * program with the default action.
+ */
+static void request_interrupt(int signal_number)
+{
+    if (!query_running)
+    {
+        return;
+    }
+
+    if (interrupt_requested)
+    {
+        signal(signal_number, SIG_DFL);
+        raise(signal_number);
+    }
+
+    interrupt_requested = 1;
+}
+
+
+/**
+ * @function parse_self_check
+ *
+ * @brief Read the optional case count and seed of --self-check
+ *
+ * @param argc is the number of arguments after --self-check
+ * @param argv is the arguments after --self-check
+ * @param rounds is set to the number of cases, SELF_CHECK_ROUNDS if not given
+ * @param seed is set to the seed, the current time if not given
+ * @return 0 on success, -1 if the count is not a positive number, the seed is not a number or there are
+ * more arguments
+ */
+static int parse_self_check(int argc, char **argv, int *rounds, uint64_t *seed)
+{
+    char *end;
+    long count;
+
+    *rounds = SELF_CHECK_ROUNDS;
+    *seed = (uint64_t) time(NULL);
+
+    if (argc > 2)
+    {
+        return -1;
+    }
+
+    if (argc > 0)
+    {
+        count = strtol(argv[0], &end, NUMBER_BASE);
+
+        if (end == argv[0] || *end != '\0' || count <= 0 || count > INT_MAX)
+        {
+            return -1;
+        }
+
+        *rounds = (int) count;
+    }
+
+    if (argc > 1)
+    {
+        if (argv[1][0] < '0' || argv[1][0] > '9')
+        {
+            return -1;
+        }
+
+        *seed = strtoull(argv[1], &end, NUMBER_BASE);
+
+        if (*end != '\0')
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Main entry point to program.
+ */
+int main(int argc, char **argv)
+{
+    char path[MAX_STDIN_LEN];                           // File path
+    char input[MAX_STDIN_LEN];                          // User input from stdin
+    char start[MAX_STDIN_LEN];
+    char end[MAX_STDIN_LEN];
+    char *temp_str;
+    int i;
+    int choice;
+    int result;
+    int corrupt;
+    int count;
+    int rounds;
+    int ids[SUGGESTION_COUNT];
+    double scores[SUGGESTION_COUNT];
+    double started;
+    struct Chunk *chunks;
+    struct LoadStats load_stats;
+    struct HashTable *movies;
+    struct HashTable *actors;
+    struct Graph *graph;
+    struct NameIndex *index;
+    struct SearchContext *ctx;
+    struct SearchFilter *filter;
+    char list[BUFFER_SIZE];
+    int start_id;
+    int end_id;
+    uint64_t path_count;
+    uint64_t first_path;
+    uint64_t path_limit;
+    uint64_t listed;
+    uint64_t seed;
+    struct PathCursor *cursor;
+    struct LevelPrinter printer;
+    int depth;
+    struct ExternalGraph *external;
+    long histogram[UNREACHED];
+    struct WeightedGraph *weighted;
+    long cost;
+    struct CentralityResult *centrality;
+    double centrality_error;
+    double timeout;
+    long max_expanded;
+    struct sigaction interrupt_action;
+
+    timeout = 0;
+    max_expanded = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--self-check") == 0 && parse_self_check(argc - i - 1, argv + i + 1, &rounds, &seed) == 0)
+        {
+            return self_check(rounds, seed);
+        }
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+        {
+            timeout = strtod(argv[++i], &temp_str);
+        }
+        else if (strcmp(argv[i], "--max-expanded") == 0 && i + 1 < argc)
+        {
+            max_expanded = strtol(argv[++i], &temp_str, NUMBER_BASE);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--timeout seconds] [--max-expanded actors] [--self-check [cases] [seed]]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("\nPlease enter file path: \n");
+    printf("(Example: /home/mert/input-mpaa.txt)\n");
+
+    fscanf(stdin, "%s", path);
+
+    /* An adjacency file is queried out of core, the graph is not loaded */
+    external = open_external_graph(path, &corrupt);
+
+    if (corrupt)
+    {
+        fprintf(stderr, "The adjacency file is truncated or corrupt: %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    if (external != NULL)
+    {
+        getchar();
+        printf("Adjacency file with %" PRId64 " actors and %" PRId64 " movies\n", external->header.actor_count,
+               external->header.movie_count);
+        printf("Please enter an actor name for a Bacon sweep: \n");
+        printf("Example: Bacon, Kevin\n");
+        read_line(start, MAX_STDIN_LEN);
+
+        started = now_seconds();
+        start_id = external_find_actor(external, start);
+
+        if (start_id == -1)
+        {
+            printf("Could not found the actor in the file. Please check again.\n");
+        }
+        else
+        {
+            result = external_bacon_sweep(external, start_id, histogram);
+
+            if (result != -1)
+            {
+                print_external_sweep(external, histogram, result, now_seconds() - started);
+            }
+        }
+
+        close_external_graph(external);
+        return EXIT_SUCCESS;
+    }
+
+    if (load_file(path, &movies, &actors, &chunks, &load_stats) == -1)
+    {
+        fprintf(stderr, "Could not load file: %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    print_load_stats(&load_stats);
+
+    graph = build_graph(movies, actors);
+    index = build_name_index(graph);
+    ctx = create_search_context(graph);
+    weighted = NULL;
+
+    /* Ctrl-C stops the running query, a second one while it stops ends the program */
+    memset(&interrupt_action, 0, sizeof(struct sigaction));
+    interrupt_action.sa_handler = request_interrupt;
+    interrupt_action.sa_flags = SA_RESTART;
+    sigemptyset(&interrupt_action.sa_mask);
+    sigaction(SIGINT, &interrupt_action, NULL);
+    set_search_limits(ctx, timeout, max_expanded, &interrupt_requested);
+
+    do
+    {
+        printf("Please enter your operation type: \n");
+        printf("1. Find Bacon Number (Distance of an actor to Kevin Bacon)\n");
+        printf("2. Find Distance (Distance of two actors)\n");
+        printf("3. Search Actor Names (Autocomplete and suggestions)\n");
+        printf("4. Find Distance With Constraints (Year range, excluded actors and movies)\n");
+        printf("5. Find All Shortest Paths (Count and list every shortest chain)\n");
+        printf("6. Find Actors Within Distance (Everyone within d hops of an actor)\n");
+        printf("7. Benchmark Tokenizer (Scalar and SIMD delimiter scanners, GB/s)\n");
+        printf("8. Write Adjacency File (For out of core Bacon sweeps)\n");
+        printf("9. Benchmark BFS Kernels (Prefetching, parallel, compact ids, NUMA placement and pinning)\n");
+        printf("10. Find Strongest Connection (Chain weighted by cast size and billing)\n");
+        printf("11. Rank Connector Actors (Betweenness and closeness centrality)\n");
+
+        scanf("%s", input);
+        choice = strtol(input, &temp_str, NUMBER_BASE);
+        getchar();
+
+        interrupt_requested = 0;
+        query_running = 1;
+
+        printf("Please enter valid input\n");
+        printf("Example: Bacon, Kevin\n");
+
+        if (choice == 1)
+        {
+            printf("Please enter an actor name: \n");
+            scanf("%[^\n]s", start);
+            getchar();
+
+            start_id = find_actor_id(actors, start);
+            end_id = find_actor_id(actors, "Bacon, Kevin");
+            result = -1;
+
+            /* The search context keeps the limits and sees Ctrl-C, the legacy search does not */
+            if (start_id != -1 && end_id != -1)
+            {
+                result = find_distance_filtered(ctx, start_id, end_id, NULL);
+
+                if (result >= 0)
+                {
+                    print_path(ctx, end_id);
+                }
+            }
+
+            if (result == -1)
+            {
+                printf("Invalid input(s) or no connection\n");
+                print_suggestions(index, graph, start);
+            }
+            else if (result == SEARCH_STOPPED)
+            {
+                printf("Search stopped after %ld actors: Bacon Number is at least %ld\n", ctx->expanded,
+                       ctx->lower_bound);
+            }
+            else
+            {
+                printf("Bacon Number: %d\n", result);
+            }
+        }
+        else if (choice == 2)
+        {
+            printf("Please enter first actor name: \n");
+            scanf("%[^\n]s", start);
+            getchar();
+
+            printf("Please enter second actor name: \n");
+            scanf("%[^\n]s", end);
+            getchar();
+
+            start_id = find_actor_id(actors, start);
+            end_id = find_actor_id(actors, end);
+            result = -1;
+
+            if (start_id != -1 && end_id != -1)
+            {
+                result = find_distance_filtered(ctx, start_id, end_id, NULL);
+
+                if (result >= 0)
+                {
+                    print_path(ctx, end_id);
+                }
+            }
+
+            if (result == -1)
+            {
+                printf("Invalid input(s) or no connection\n");
+                print_suggestions(index, graph, start);
+                print_suggestions(index, graph, end);
+            }
+            else if (result == SEARCH_STOPPED)
+            {
+                printf("Search stopped after %ld actors: distance is at least %ld\n", ctx->expanded,
+                       ctx->lower_bound);
+            }
+            else
+            {
+                printf("Distance: %d\n", result);
+            }
+        }
+        else if (choice == 3)
+        {
+            printf("Please enter a name or the beginning of a name: \n");
+            scanf("%[^\n]s", start);
+            getchar();
+
+            started = now_seconds();
+            count = complete_name(index, start, ids, SUGGESTION_COUNT);
+
+            printf("Names starting with \"%s\":\n", start);
+            for (i = 0; i < count; i++)
+            {
+                printf("  %s\n", graph->actor_names[ids[i]]);
+            }
+
+            count = suggest_names(index, start, ids, scores, SUGGESTION_COUNT);
+
+            printf("Similar names:\n");
+            for (i = 0; i < count; i++)
+            {
+                printf("  %s (%.2f)\n", graph->actor_names[ids[i]], scores[i]);
+            }
+
+            printf("Lookup time: %.3f ms\n", (now_seconds() - started) * 1000.0);
+        }
+        else if (choice == 4)
+        {
+            filter = create_search_filter(graph);
+
+            printf("Please enter first actor name: \n");
+            read_line(start, MAX_STDIN_LEN);
+
+            printf("Please enter second actor name: \n");
+            read_line(end, MAX_STDIN_LEN);
+
+            printf("Please enter year range (Example: 1980 2019, 0 for no limit): \n");
+            read_line(input, MAX_STDIN_LEN);
+            sscanf(input, "%d %d", &filter->min_year, &filter->max_year);
+
+            printf("Please enter actors to exclude, separated by / (Empty for none): \n");
+            read_line(list, BUFFER_SIZE);
+            read_exclusions(list, actors, 0, filter->excluded_actors);
+
+            printf("Please enter movies to exclude, separated by / (Empty for none): \n");
+            read_line(list, BUFFER_SIZE);
+            read_exclusions(list, movies, 1, filter->excluded_movies);
+
+            start_id = find_actor_id(actors, start);
+            end_id = find_actor_id(actors, end);
+            result = -1;
+
+            if (start_id == -1 || end_id == -1)
+            {
+                printf("Could not found one or two of actors in the table. Please check again.\n");
+                print_suggestions(index, graph, start);
+                print_suggestions(index, graph, end);
+            }
+            else
+            {
+                started = now_seconds();
+                result = find_distance_filtered(ctx, start_id, end_id, filter);
+
+                if (result >= 0)
+                {
+                    print_path(ctx, end_id);
+                }
+
+                printf("Search time: %.3f ms\n", (now_seconds() - started) * 1000.0);
+            }
+
+            if (result == -1)
+            {
+                printf("Invalid input(s) or no connection\n");
+            }
+            else if (result == SEARCH_STOPPED)
+            {
+                printf("Search stopped after %ld actors: distance is at least %ld\n", ctx->expanded,
+                       ctx->lower_bound);
+            }
+            else
+            {
+                printf("Distance: %d\n", result);
+            }
+
+            free_search_filter(filter);
+        }
+        else if (choice == 5)
+        {
+            printf("Please enter first actor name: \n");
+            read_line(start, MAX_STDIN_LEN);
+
+            printf("Please enter second actor name: \n");
+            read_line(end, MAX_STDIN_LEN);
+
+            printf("Please enter the first path number and the number of paths to list (Example: 0 10): \n");
+            read_line(input, MAX_STDIN_LEN);
+
+            first_path = 0;
+            path_limit = SUGGESTION_COUNT;
+            sscanf(input, "%" SCNu64 " %" SCNu64, &first_path, &path_limit);
+
+            start_id = find_actor_id(actors, start);
+            end_id = find_actor_id(actors, end);
+            result = -1;
+
+            if (start_id == -1 || end_id == -1)
+            {
+                printf("Could not found one or two of actors in the table. Please check again.\n");
+                print_suggestions(index, graph, start);
+                print_suggestions(index, graph, end);
+            }
+            else
+            {
+                result = count_shortest_paths(ctx, start_id, end_id, NULL, &path_count);
+            }
+
+            if (result == -1)
+            {
+                printf("Invalid input(s) or no connection\n");
+            }
+            else if (result == SEARCH_STOPPED)
+            {
+                printf("Search stopped after %ld actors: distance is at least %ld\n", ctx->expanded,
+                       ctx->lower_bound);
+            }
+            else
+            {
+                printf("Distance: %d\n", result);
+
+                if (path_count == UINT64_MAX)
+                {
+                    printf("Number of shortest paths: at least %" PRIu64 "\n", path_count);
+                }
+                else
+                {
+                    printf("Number of shortest paths: %" PRIu64 "\n", path_count);
+                }
+
+                cursor = create_path_cursor(ctx, end_id, result);
+                listed = 0;
+
+                if (path_cursor_seek(cursor, first_path))
+                {
+                    do
+                    {
+                        printf("Path %" PRIu64 ":\n", first_path + listed);
+                        print_cursor_path(cursor);
+                        listed++;
+                    } while (listed < path_limit && path_cursor_next(cursor));
+                }
+
+                free_path_cursor(cursor);
+            }
+        }
+        else if (choice == 6)
+        {
+            printf("Please enter an actor name: \n");
+            read_line(start, MAX_STDIN_LEN);
+
+            printf("Please enter the maximum distance: \n");
+            read_line(input, MAX_STDIN_LEN);
+            depth = strtol(input, &temp_str, NUMBER_BASE);
+
+            printf("Please enter 1 to list names (sorted by movie count), 0 to list only counts: \n");
+            read_line(input, MAX_STDIN_LEN);
+
+            printer.graph = graph;
+            printer.print_names = strtol(input, &temp_str, NUMBER_BASE) == 1;
+            printer.last_level = 0;
+
+            start_id = find_actor_id(actors, start);
+
+            if (start_id == -1)
+            {
+                printf("Could not found the actor in the table. Please check again.\n");
+                print_suggestions(index, graph, start);
+            }
+            else
+            {
+                result = expand_neighborhood(ctx, start_id, depth, NULL, printer.print_names, print_level, &printer);
+
+                if (result == SEARCH_STOPPED)
+                {
+                    printf("Search stopped after %ld actors: at least %ld actors within distance %d\n",
+                           ctx->expanded, ctx->lower_bound, depth);
+                }
+                else
+                {
+                    printf("Actors within distance %d: %d\n", depth, result);
+                }
+            }
+        }
+        else if (choice == 7)
+        {
+            benchmark_tokenizer(path);
+        }
+        else if (choice == 8)
+        {
+            printf("Please enter the adjacency file path: \n");
+            read_line(end, MAX_STDIN_LEN);
+
+            if (write_adjacency_file(graph, end, ADJACENCY_BLOCK_SIZE) == -1)
+            {
+                fprintf(stderr, "Could not write file: %s\n", end);
+            }
+            else
+            {
+                printf("Adjacency file written. Open it instead of the text file for an out of core sweep.\n");
+            }
+        }
+        else if (choice == 9)
+        {
+            printf("Please enter an actor name: \n");
+            read_line(start, MAX_STDIN_LEN);
+
+            printf("Please enter the number of threads (0 for one per CPU): \n");
+            read_line(input, MAX_STDIN_LEN);
+
+            start_id = find_actor_id(actors, start);
+
+            if (start_id == -1)
+            {
+                printf("Could not found the actor in the table. Please check again.\n");
+                print_suggestions(index, graph, start);
+            }
+            else
+            {
+                benchmark_bfs(ctx, start_id, strtol(input, &temp_str, NUMBER_BASE));
+            }
+        }
+        else if (choice == 10)
+        {
+            printf("Please enter first actor name: \n");
+            read_line(start, MAX_STDIN_LEN);
+
+            printf("Please enter second actor name: \n");
+            read_line(end, MAX_STDIN_LEN);
+
+            start_id = find_actor_id(actors, start);
+            end_id = find_actor_id(actors, end);
+
+            if (start_id == -1 || end_id == -1)
+            {
+                printf("Invalid input(s) or no connection\n");
+                print_suggestions(index, graph, start_id == -1 ? start : end);
+            }
+            else
+            {
+                if (weighted == NULL)
+                {
+                    weighted = create_weighted_graph(graph);
+                }
+
+                started = now_seconds();
+                cost = find_strongest_link(weighted, ctx, start_id, end_id, &depth);
+
+                if (cost == -1)
+                {
+                    printf("Invalid input(s) or no connection\n");
+                }
+                else if (cost == SEARCH_STOPPED)
+                {
+                    printf("Search stopped after %ld actors: cost is at least %ld\n", ctx->expanded, ctx->lower_bound);
+                }
+                else
+                {
+                    print_path(ctx, end_id);
+                    printf("Distance: %d\n", depth);
+                    printf("Cost: %ld (%.3f ms)\n", cost, (now_seconds() - started) * 1e3);
+                }
+            }
+        }
+        else if (choice == 11)
+        {
+            printf("Please enter the error bound (0 for exact, 0.05 for a sample): \n");
+            read_line(input, MAX_STDIN_LEN);
+            centrality_error = strtod(input, &temp_str);
+
+            printf("Please enter the number of actors to list: \n");
+            read_line(input, MAX_STDIN_LEN);
+            count = strtol(input, &temp_str, NUMBER_BASE);
+
+            centrality = compute_centrality(graph, centrality_error, 0, (uint64_t) time(NULL) | 1);
+            print_top_centrality(graph, centrality, count > 0 ? count : SUGGESTION_COUNT);
+            free_centrality(centrality);
+        }
+        else
+        {
+            printf("Invalid choice\n");
+        }
+
+        query_running = 0;
+    } while (choice == 0);
+
+    if (weighted != NULL)
+    {
+        free_weighted_graph(weighted);
+    }
+
+    free_search_context(ctx);
+    free_name_index(index);
+    free_graph(graph);
+    free_hash_tables(movies, actors);
+
+    /** Free chunks */
+    free_chunks(chunks);
+
+    return 0;
+}
+
+
+/**
+ * @function parse_line
+ *
+ * @brief Tokenize a string
+ *
+ * @discussion
+ * <p>This function tokenize a line and returns a pointer to tokenized string array.
+ *
+ * @param line is the string to tokenize
+ * @return array of string (tokens)
+ */
+char **parse_line(char *line)
+{
+    int buffer_size;
+    int i;
+    char **tokens;
+    char *token;
+
+    buffer_size = 64;
+    i = 0;
+
+    tokens = malloc(buffer_size * sizeof(char*));
+
+    /* Memory allocation control */
+    if (tokens == NULL)
+    {
+        fprintf(stderr, "Token allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Get first token */
+    token = strtok(line, TOKEN_DELIMITER);
+
+    while (token != NULL)
+    {
+        tokens[i] = token;
+        i++;
+
+        if (i >= buffer_size)
+        {
+            /* Reallocation of the tokens array */
+            buffer_size += 64;
+            tokens = realloc(tokens, buffer_size * sizeof(char*));
+
+            /* Memory allocation control */
+            if (!tokens)
+            {
+                fprintf(stderr, "Token allocation error\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        /* Read next token */
+        token = strtok(NULL, TOKEN_DELIMITER);
+    }
+
+    tokens[i] = NULL;
+
+    return tokens;
+}
+
+
+/**
+ * @function create_hash_table
+ *
+ * @brief Initialize a new instance of struct HashTable
+ *
+ * @discussion
+ * <p>This function allocates memory for a new instance of struct HashTable, then initializes
+ * fields and returns a pointer to new instance.
+ *
+ * @param m is the size of the hash table
+ * @return pointer to HashTable instance
+ */
+struct HashTable *create_hash_table(int m)
+{
+    int i;
+    struct HashTable *ht;
+
+    ht = malloc(m * sizeof(struct HashTable));
+    ht->table_size = m;
+
+    for (i = 0; i < m; i++)
+    {
+        ht[i].table_size = m;
+        ht[i].head = NULL;
+        ht[i].count = 0;
+    }
+
+    return ht;
+}
+
+
+/**
+ * @function create_movie
+ *
+ * @brief Initialize a new instance of struct Movie
+ *
+ * @discussion
+ * <p>This function allocates memory for a new instance of struct Movie, then initializes
+ * fields and returns a pointer to new instance.
+ *
+ * @param name is the movie's name
+ * @return pointer to Movie instance
+ */
+struct Movie *create_movie(char *name)
+{
+    struct Movie *m;
+
+    m = malloc(sizeof(struct Movie));
+
+    m->name = name;
+    m->actor_count = 0;
+    m->actors = NULL;
+    m->visited = 0;
+    m->id = -1;
+
+    return m;
+}
+
+
+/**
+ * @function create_actor
+ *
+ * @brief Initialize a new instance of struct Actor
+ *
+ * @discussion
+ * <p>This function allocates memory for a new instance of struct Actor, then initializes
+ * fields and returns a pointer to new instance.
+ *
+ * @param name is the actor's name
+ * @return pointer to Actor instance
+ */
+struct Actor *create_actor(char *name)
+{
+    struct Actor *a;
+
+    a = (struct Actor*) malloc(sizeof(struct Actor));
+
+    a->name = name;
+    a->movie_count = 0;
+    a->movies = NULL;
+    a->visited = 0;
+    a->parent_movie_name = NULL;
+    a->parent = NULL;
+    a->id = -1;
+
+    return a;
+}
+
+
+/**
+ * @function hash
+ *
+ * @brief Calculates hash of a string
+ *
+ * @discussion
+ * <p>This function calculates hash value of the given string, and returns the hash value.
+ *
+ * @param str is the string to calculate hash value
+ * @return hash value of the given string
+ */
+long hash(char *str)
+{
+    long hash_value;
+    long p_pow;
+    int i;
+    int len;
+
+    const int p = 31;
+    const long m = 10000000009;
+
+    hash_value = 0;
+    p_pow = 1;
+    len = (int) strlen(str);
+
+    for (i = 0; i < len; i++)
+    {
+        hash_value = (hash_value + (int) str[i] * p_pow) % m;
+        p_pow = (p_pow * p) % m;
+    }
+
+    return hash_value;
+}
+
+
+/**
+ * @function create_map_entry
+ *
+ * @brief Initialize a new instance of struct MapEntry
+ *
+ * @discussion
+ * <p>This function allocates memory for a new instance of struct MapEntry, then initializes
+ * fields and returns a pointer to new instance.
+ *
+ * @param key is the value to access MapEntry
+ * @param value is the pointer to original value to hold
+ * @return pointer to MapEntry instance
+ */
+struct MapEntry *create_map_entry(long key, void *value)
+{
+    struct MapEntry *new_node;
+
+    new_node = (struct MapEntry*) malloc(sizeof(struct MapEntry));
+
+    new_node->key = key;
+    new_node->value = value;
+    new_node->next = NULL;
+
+    return new_node;
+}
+
+
+/**
+ * @function add_movie
+ *
+ * @brief Initialize Actor and Movie objects of a line and insert them to HashTables
+ *
+ * @discussion
+ * <p>Names are not copied: the movie keeps pointers to its tokens and actors keep pointers to
+ * movie names, so the line must live as long as the tables.
+ *
+ * @param tokens is the NULL terminated tokens of a line, the first token is the movie name
+ * @param movies is the pointer to movies hash table
+ * @param actors is the pointer to actors hash table
+ */
+void add_movie(char **tokens, struct HashTable *movies, struct HashTable *actors)
+{
+    struct Movie *movie;
+    struct Actor *actor;
+    struct MapEntry *result;
+    int j;
+
+    /* Create a movie structure with a name */
+    movie = create_movie(tokens[0]);
+
+    while (tokens[movie->actor_count + 1] != NULL)
+    {
+        movie->actor_count++;
+    }
+
+    movie->actors = malloc(movie->actor_count * sizeof(char*));
+    memcpy(movie->actors, tokens + 1, movie->actor_count * sizeof(char*));
+
+    /* Creating movie completed. Insert to hashtable */
+    insert(movies, hash(movie->name), movie);
+
+    /* Inserting into actors hashtable */
+    for (j = 0; j < movie->actor_count; j++)
+    {
+        result = search(actors, hash(movie->actors[j]));
+
+        if (result != NULL)
+        {
+            actor = result->value;
+        }
+        else
+        {
+            actor = create_actor(movie->actors[j]);
+            insert(actors, hash(actor->name), actor);
+        }
+
+        actor->movie_count++;
+        actor->movies = realloc(actor->movies, actor->movie_count * sizeof(char*));
+        actor->movies[actor->movie_count - 1] = movie->name;
+    }
+}
+
+
+/**
+ * @function insert
+ *
+ * @brief Insert element to hash table
+ *
+ * @param ht is the hash table to operate on
+ * @param key is the hash value
+ * @param value is the pointer to original value
+ */
+void insert(struct HashTable *ht, long key, void *value)
+{
+    long i;
+    struct MapEntry *entry;
+
+    if (key < 0)
+    {
+        key = -key;
+    }
+
+    i = key % ht->table_size;
+    entry = create_map_entry(key, value);
+
+    if (ht[i].head == NULL)
+    {
+        ht[i].head = entry;
+        ht[i].count = 1;
+    }
+    else
+    {
+        entry->next = ht[i].head;
+        ht[i].head = entry;
+        ht[i].count++;
+    }
+}
+
+
+/**
+ * @function search
+ *
+ * @brief Search an element on the hash table
+ *
+ * @param ht is the hash table to operate on
+ * @param key is the hash value of the searched value
+ * @return pointer to map entry that has the same key or NULL
+ */
+struct MapEntry *search(struct HashTable *ht, long key)
+{
+    long i;
+    struct MapEntry *head;
+    struct MapEntry *curr;
+
+    if (key < 0)
+    {
+        key = -key;
+    }
+
+    i = key % ht->table_size;
+    head = ht[i].head;
+    curr = head;
+
+    while ((curr != NULL) && (curr->key != key))
+    {
+        curr = curr->next;
+    }
+
+    return curr;
+}
+
+
+/**
+ * @function free_hash_tables
+ *
+ * @brief Free the movies and actors hash tables with their entries
+ *
+ * @discussion
+ * <p>Names are owned by the chunks of the loader, they are not freed.
+ *
+ * @param movies is the movies hash table
+ * @param actors is the actors hash table
+ */
+void free_hash_tables(struct HashTable *movies, struct HashTable *actors)
+{
+    struct MapEntry *e;
+    struct MapEntry *next;
+    struct Movie *movie;
+    struct Actor *actor;
+    int i;
+
+    for (i = 0; i < movies->table_size; i++)
+    {
+        for (e = movies[i].head; e != NULL; e = next)
+        {
+            next = e->next;
+            movie = e->value;
+
+            free(movie->actors);
+            free(movie);
+            free(e);
+        }
+    }
+
+    for (i = 0; i < actors->table_size; i++)
+    {
+        for (e = actors[i].head; e != NULL; e = next)
+        {
+            next = e->next;
+            actor = e->value;
+
+            free(actor->movies);
+            free(actor);
+            free(e);
+        }
+    }
+
+    free(movies);
+    free(actors);
+}
+
+
+/**
+ * @function find_bacon_number
+ *
+ * @brief Find the distance of an actor to Kevin Bacon
+ *
+ * @param start is the name of the starting actor
+ * @param movies is the movies hash table
+ * @param actors is the actors hash table
+ * @return distance value
+ */
+int find_bacon_number(char *start, struct HashTable *movies, struct HashTable *actors)
+{
+    return find_distance(start, "Bacon, Kevin", movies, actors);
+}
+
+
+/**
+ * Stamp of the current find_distance search
+ */
+static unsigned int distance_epoch;
+
+
+/**
+ * @function find_distance
+ *
+ * @brief Find the distance of an actor to another
+ *
+ * @discussion
+ * <p>Every call takes a new stamp, and a node is visited only if its stamp is the current one, so
+ * nothing is cleared between searches and a call reads only the nodes it reaches. Every actor is
+ * queued once, when it is first reached. A name written on several lines is several movies: an
+ * actor's movie is the one whose name is the same string, not only an equal one.
+ *
+ * @param start is the name of the starting actor
+ * @param end is the name of the ending actor
+ * @param movies is the movies hash table
+ * @param actors is the actors hash table
+ * @return distance value
+ */
+int find_distance(char *start, char *end, struct HashTable *movies, struct HashTable *actors)
+{
+    struct Queue *q;
+    struct MapEntry *tmp_map_entry;
+    struct Actor *s;
+    struct Actor *curr_actor;
+    struct Actor *next_actor;
+    struct Actor *tmp_actor;
+    struct Movie *curr_movie;
+    struct QueueNode *node;
+    char *v;
+    int i;
+    int j;
+    int num;
+
+    if ((search(actors, hash(start)) == NULL) || (search(actors, hash(end)) == NULL))
+    {
+        printf("Could not found one or two of actors in the table. Please check again.\n");
+        return -1;
+    }
+
+    distance_epoch++;
+
+    /* Stamps are cleared only when the counter wraps */
+    if (distance_epoch == 0)
+    {
+        for (i = 0; i < movies->table_size; i++)
+        {
+            for (tmp_map_entry = movies[i].head; tmp_map_entry != NULL; tmp_map_entry = tmp_map_entry->next)
+            {
+                ((struct Movie *) tmp_map_entry->value)->visited = 0;
+            }
+        }
+
+        for (i = 0; i < actors->table_size; i++)
+        {
+            for (tmp_map_entry = actors[i].head; tmp_map_entry != NULL; tmp_map_entry = tmp_map_entry->next)
+            {
+                ((struct Actor *) tmp_map_entry->value)->visited = 0;
+            }
+        }
+
+        distance_epoch = 1;
+    }
+
+    q = create_queue();
+    enqueue(q, start);
+
+    tmp_map_entry = search(actors, hash(start)); // tmp can not be NULL
+    s = tmp_map_entry->value;
+    s->visited = distance_epoch;
+    s->parent = NULL;
+    s->parent_movie_name = NULL;
+
+    while (q->front != NULL)
+    {
+        node = (struct QueueNode *) dequeue(q);
+        v = node->value;
+
+        if (strcmp(v, end) == 0)
+        {
+            num = 0;
+            curr_actor = search(actors, hash(v))->value;
+            next_actor = curr_actor->parent;
+
+            while (curr_actor != NULL)
+            {
+                if (next_actor != NULL)
+                {
+                    printf("%s - %s: \"%s\"\n", curr_actor->name, next_actor->name, curr_actor->parent_movie_name);
+                    next_actor = next_actor->parent;
+                }
+
+                curr_actor = curr_actor->parent;
+                num++;
+            }
+
+            free(node);
+
+            while (q->front != NULL)
+            {
+                node = dequeue(q);
+                free(node);
+            }
+
+            free(q);
+
+            return num - 1;
+        }
+
+        curr_actor = search(actors, hash(v))->value;
+
+        /* Search every not searched movie, add not visited actors to queue */
+        for (i = 0; i < curr_actor->movie_count; i++)
+        {
+            /* Movies with the same name are in the same chain */
+            tmp_map_entry = search(movies, hash(curr_actor->movies[i]));
+            while (((struct Movie *) tmp_map_entry->value)->name != curr_actor->movies[i])
+            {
+                tmp_map_entry = tmp_map_entry->next;
+            }
+
+            curr_movie = tmp_map_entry->value;
+
+            if (curr_movie->visited != distance_epoch)
+            {
+                curr_movie->visited = distance_epoch;
+
+                for (j = 0; j < curr_movie->actor_count; j++)
+                {
+                    tmp_actor = search(actors, hash(curr_movie->actors[j]))->value;
+
+                    if (tmp_actor->visited != distance_epoch)
+                    {
+                        tmp_actor->visited = distance_epoch;
+                        tmp_actor->parent = curr_actor;
+                        tmp_actor->parent_movie_name = curr_movie->name;
+                        enqueue(q, tmp_actor->name);
+                    }
+                }
+            }
+        }
+
+        free(node);
+    }
+
+    free(q);
+
+    return -1;
+}
+
+
+/**
+ * @function create_queue_node
+ *
+ * @brief creates a new node for queue
+ *
+ * @discussion
+ * <p>Function wraps a value with
+ * necessary queue values and returns a pointer to it.
+ *
+ * @see {@code struct Queue}
+ * @see {@code struct QueueNode}
+ *
+ * @author Mert Turkmenoglu
+ *
+ * @param value is the pointer to original value
+ * @return a pointer to wrapped instance
+ */
+struct QueueNode* create_queue_node(void* value)
+{
+    struct QueueNode *temp;
+
+    temp = (struct QueueNode *) malloc(sizeof(struct QueueNode));
+
+    temp->value = value;
+    temp->next = NULL;
+
+    return temp;
+}
+
+
+/**
+ * @function create_queue
+ *
+ * @brief creates a struct Queue instance
+ *
+ * @discussion
+ * <p>Function allocates memory for a queue instance then
+ * assigns front and rear pointers to NULL.
+ *
+ * @see {@code struct Queue}
+ * @see {@code struct QueueNode}
+ *
+ * @author Mert Turkmenoglu
+ *
+ * @return pointer to new created queue instance
+ */
+struct Queue *create_queue()
+{
+    struct Queue *q;
+
+    q = (struct Queue*) malloc(sizeof(struct Queue));
+
+    q->front = NULL;
+    q->rear = NULL;
+
+    return q;
+}
+
+
+/**
+ * @function enqueue
+ *
+ * @brief Adds new element to queue
+ *
+ * @discussion
+ * <p>Function adds a new element to end of the queue.
+ *
+ * @see {@code struct Queue}
+ * @see {@code struct QueueNode}
+ *
+ * @author Mert Turkmenoglu
+ *
+ * @param q is the queue instance to operate on
+ * @param value is the pointer to new element to add queue
+ */
+void enqueue(struct Queue *q, void *value)
+{
+    struct QueueNode *temp;
+
+    temp = create_queue_node(value);
+
+    if (q->rear == NULL)
+    {
+        q->front = temp;
+        q->rear = temp;
+        return;
+    }
+
+    q->rear->next = temp;
+    q->rear = temp;
+}
+
+
+/**
+ * @function dequeue
+ *
+ * @brief deques element
+ *
+ * @discussion
+ * <p> Function removes the first element of the queue
+ * and returns the element. If it is empty, returns NULL.
+ *
+ * @see {@code struct Queue}
+ * @see {@code struct QueueNode}
+ *
+ * @author Mert Turkmenoglu
+ *
+ * @param q is the queue instance to operate on
+ * @return the first element of the queue
+ */
+void *dequeue(struct Queue *q)
+{
+    void *temp;
+
+    if (q->front == NULL)
+    {
+        return NULL;
+    }
+
+    temp = q->front;
+    q->front = q->front->next;
+
+    if (q->front == NULL)
+    {
+        q->rear = NULL;
+    }
+
+    return temp;
+}
+
+
+/**
+ * @function now_seconds
+ *
+ * @brief Read the monotonic clock
+ *
+ * @return current time in seconds
+ */
+double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * @function label_components
+ *
+ * @brief Give every actor the id of its connected component
+ *
+ * @discussion
+ * <p>A BFS from every actor not labeled yet labels its component. Movies are marked with the
+ * component that expanded them, so each movie row is read once.
+ *
+ * @param g is the graph
+ */
+static void label_components(struct Graph *g)
+{
+    int *queue;
+    int *movie_components;
+    int head;
+    int tail;
+    int a;
+    int m;
+    int i;
+    int j;
+
+    g->actor_components = malloc((g->actor_count + 1) * sizeof(int));
+    movie_components = malloc((g->movie_count + 1) * sizeof(int));
+    queue = malloc((g->actor_count + 1) * sizeof(int));
+
+    if (g->actor_components == NULL || movie_components == NULL || queue == NULL)
+    {
+        fprintf(stderr, "Graph allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(g->actor_components, -1, g->actor_count * sizeof(int));
+    memset(movie_components, -1, g->movie_count * sizeof(int));
+    g->component_count = 0;
+
+    for (a = 0; a < g->actor_count; a++)
+    {
+        if (g->actor_components[a] != -1)
+        {
+            continue;
+        }
+
+        g->actor_components[a] = g->component_count;
+        queue[0] = a;
+        head = 0;
+        tail = 1;
+
+        while (head < tail)
+        {
+            for (i = g->actor_offsets[queue[head]]; i < g->actor_offsets[queue[head] + 1]; i++)
+            {
+                m = g->actor_movies[i];
+
+                if (movie_components[m] != -1)
+                {
+                    continue;
+                }
+
+                movie_components[m] = g->component_count;
+
+                for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+                {
+                    if (g->actor_components[g->movie_actors[j]] == -1)
+                    {
+                        g->actor_components[g->movie_actors[j]] = g->component_count;
+                        queue[tail++] = g->movie_actors[j];
+                    }
+                }
+            }
+
+            head++;
+        }
+
+        g->component_count++;
+    }
+
+    free(queue);
+    free(movie_components);
+}
+
+
+/**
+ * @function build_graph
+ *
+ * @brief Give every actor and movie an id and create a struct Graph
+ *
+ * @discussion
+ * <p>This function walks the hash tables, assigns dense ids to actors and movies in table order,
+ * then builds the movie rows from the cast lists and the actor rows by transposing the movie rows.
+ * An actor written twice in the same cast list appears once in the movie row. Connected components
+ * are labeled last.
+ *
+ * @param movies is the movies hash table
+ * @param actors is the actors hash table
+ * @return pointer to Graph instance
+ */
+struct Graph *build_graph(struct HashTable *movies, struct HashTable *actors)
+{
+    struct Graph *g;
+    struct MapEntry *e;
+    struct Actor *actor;
+    struct Movie *movie;
+    int *fill;
+    int i;
+    int j;
+    int n;
+    int a;
+
+    g = malloc(sizeof(struct Graph));
+
+    /* Actor ids */
+    n = 0;
+    for (i = 0; i < actors->table_size; i++)
+    {
+        n += actors[i].count;
+    }
+
+    g->actor_count = n;
+    g->actor_names = malloc((n + 1) * sizeof(char*));
+
+    n = 0;
+    for (i = 0; i < actors->table_size; i++)
+    {
+        for (e = actors[i].head; e != NULL; e = e->next)
+        {
+            actor = e->value;
+            actor->id = n;
+            g->actor_names[n++] = actor->name;
+        }
+    }
+
+    /* Movie ids, names and years */
+    n = 0;
+    for (i = 0; i < movies->table_size; i++)
+    {
+        n += movies[i].count;
+    }
+
+    g->movie_count = n;
+    g->movie_names = malloc((n + 1) * sizeof(char*));
+    g->movie_years = malloc((n + 1) * sizeof(short));
+    g->movie_offsets = malloc((n + 1) * sizeof(int));
+    g->actor_offsets = calloc(g->actor_count + 1, sizeof(int));
+
+    if (g->actor_names == NULL || g->movie_names == NULL || g->movie_years == NULL ||
+        g->movie_offsets == NULL || g->actor_offsets == NULL)
+    {
+        fprintf(stderr, "Graph allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    n = 0;
+    a = 0;
+    for (i = 0; i < movies->table_size; i++)
+    {
+        for (e = movies[i].head; e != NULL; e = e->next)
+        {
+            movie = e->value;
+            movie->id = n;
+            g->movie_names[n] = movie->name;
+            g->movie_years[n] = (short) parse_movie_year(movie->name);
+            a += movie->actor_count;
+            n++;
+        }
+    }
+
+    /* Movie rows, in id order */
+    g->movie_actors = malloc((a + 1) * sizeof(int));
+    g->actor_movies = malloc((a + 1) * sizeof(int));
+    fill = malloc((g->actor_count + 1) * sizeof(int));
+
+    if (g->movie_actors == NULL || g->actor_movies == NULL || fill == NULL)
+    {
+        fprintf(stderr, "Graph allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* fill holds the last movie of each actor while movie rows are built */
+    for (i = 0; i < g->actor_count; i++)
+    {
+        fill[i] = -1;
+    }
+
+    n = 0;
+    g->movie_offsets[0] = 0;
+    for (i = 0; i < movies->table_size; i++)
+    {
+        for (e = movies[i].head; e != NULL; e = e->next)
+        {
+            movie = e->value;
+
+            for (j = 0; j < movie->actor_count; j++)
+            {
+                actor = search(actors, hash(movie->actors[j]))->value;
+
+                if (fill[actor->id] != movie->id)
+                {
+                    fill[actor->id] = movie->id;
+                    g->movie_actors[n++] = actor->id;
+                    g->actor_offsets[actor->id + 1]++;
+                }
+            }
+
+            g->movie_offsets[movie->id + 1] = n;
+        }
+    }
+
+    /* Actor rows, transpose of movie rows */
+    for (i = 0; i < g->actor_count; i++)
+    {
+        g->actor_offsets[i + 1] += g->actor_offsets[i];
+    }
+
+    memcpy(fill, g->actor_offsets, g->actor_count * sizeof(int));
+
+    for (i = 0; i < g->movie_count; i++)
+    {
+        for (j = g->movie_offsets[i]; j < g->movie_offsets[i + 1]; j++)
+        {
+            a = g->movie_actors[j];
+            g->actor_movies[fill[a]++] = i;
+        }
+    }
+
+    free(fill);
+    label_components(g);
+
+    return g;
+}
+
+
+/**
+ * @function free_graph
+ *
+ * @brief Free a struct Graph instance
+ *
+ * @param g is the graph to free
+ */
+void free_graph(struct Graph *g)
+{
+    free(g->actor_names);
+    free(g->movie_names);
+    free(g->actor_offsets);
+    free(g->actor_movies);
+    free(g->movie_offsets);
+    free(g->movie_actors);
+    free(g->movie_years);
+    free(g->actor_components);
+    free(g);
+}
+
+
+/**
+ * @function parse_movie_year
+ *
+ * @brief Read the release year from a movie name
+ *
+ * @discussion
+ * <p>Movie names end with the release year in parentheses, like "Title (1994)". A roman numeral
+ * may follow the year to separate movies with the same title, like "Title (1994/II)".
+ *
+ * @param name is the movie name
+ * @return release year or 0 if the name does not have a year
+ */
+int parse_movie_year(char *name)
+{
+    char *p;
+    int year;
+    int i;
+    int k;
+
+    /* Parentheses may be in the title too, try them from the last one */
+    for (k = (int) strlen(name) - 1; k >= 0; k--)
+    {
+        if (name[k] != '(')
+        {
+            continue;
+        }
+
+        p = name + k;
+        year = 0;
+
+        for (i = 1; i <= 4 && p[i] >= '0' && p[i] <= '9'; i++)
+        {
+            year = year * NUMBER_BASE + (p[i] - '0');
+        }
+
+        if (i == 5 && (p[5] == ')' || p[5] == '/'))
+        {
+            return year;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @function fold_char
+ *
+ * @brief Fold a Latin-1 Supplement or Latin Extended-A code point
+ *
+ * @discussion
+ * <p>Letters with diacritics are mapped to their base letters. Ligatures and a few letters are
+ * mapped to two letters.
+ *
+ * @param cp is the code point in range 0xC0 - 0x17F
+ * @param out is the buffer to write folded letters, it must hold 3 characters
+ * @return folded ASCII string of the code point
+ */
+static char *fold_char(int cp, char *out)
+{
+    static char *latin1 = "aaaaaa*ceeeeiiiidnooooo ouuuuy**aaaaaa*ceeeeiiiidnooooo ouuuuy*y";
+    static char *extended_a = "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii**jjkkkllllllllll"
+                              "nnnnnnnnnoooooo**rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+    switch (cp)
+    {
+        case 0xC6: case 0xE6: return "ae";
+        case 0xDE: case 0xFE: return "th";
+        case 0xDF: return "ss";
+        case 0x132: case 0x133: return "ij";
+        case 0x152: case 0x153: return "oe";
+        default: break;
+    }
+
+    out[0] = (cp < 0x100) ? latin1[cp - 0xC0] : extended_a[cp - 0x100];
+    out[1] = '\0';
+
+    return out;
+}
+
+
+/**
+ * @function fold_name
+ *
+ * @brief Fold case and diacritics of a name
+ *
+ * @discussion
+ * <p>This function lowers ASCII letters, maps accented Latin letters (UTF-8 or Latin-1 encoded) to
+ * their base letters and turns punctuation into single spaces, so "Müller, José" and "muller jose"
+ * have the same folded form. Other bytes are copied as they are.
+ *
+ * @param src is the name to fold
+ * @param dst is the buffer to write folded name
+ * @param size is the size of the buffer
+ * @return length of the folded name
+ */
+int fold_name(char *src, char *dst, int size)
+{
+    unsigned char *s;
+    char letters[3];
+    char *folded;
+    int len;
+    int cp;
+
+    s = (unsigned char *) src;
+    len = 0;
+
+    while (*s != '\0' && len < size - 2)
+    {
+        cp = -1;
+
+        if (*s >= 0xC3 && *s <= 0xC5 && (s[1] & 0xC0) == 0x80)
+        {
+            cp = ((*s & 0x1F) << 6) | (s[1] & 0x3F);
+            s += 2;
+        }
+        else if (*s >= 0xC0 && (s[1] & 0xC0) != 0x80)
+        {
+            /* Not a multi byte sequence, read it as Latin-1 */
+            cp = *s++;
+        }
+
+        if (cp != -1)
+        {
+            for (folded = fold_char(cp, letters); *folded != '\0' && len < size - 2; folded++)
+            {
+                if (*folded != ' ' || (len > 0 && dst[len - 1] != ' '))
+                {
+                    dst[len++] = *folded;
+                }
+            }
+        }
+        else if (*s >= 0x80 || (*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'z'))
+        {
+            dst[len++] = (char) *s++;
+        }
+        else if (*s >= 'A' && *s <= 'Z')
+        {
+            dst[len++] = (char) (*s++ - 'A' + 'a');
+        }
+        else
+        {
+            /* Punctuation and white space separate words */
+            if (len > 0 && dst[len - 1] != ' ')
+            {
+                dst[len++] = ' ';
+            }
+            s++;
+        }
+    }
+
+    if (len > 0 && dst[len - 1] == ' ')
+    {
+        len--;
+    }
+
+    dst[len] = '\0';
+
+    return len;
+}
+
+
+/**
+ * @function trigram_symbol
+ *
+ * @brief Map a folded character to a 6 bit trigram symbol
+ *
+ * @param c is the character
+ * @return symbol value
+ */
+static int trigram_symbol(unsigned char c)
+{
+    if (c == ' ')
+    {
+        return 0;
+    }
+    else if (c >= 'a' && c <= 'z')
+    {
+        return c - 'a' + 1;
+    }
+    else if (c >= '0' && c <= '9')
+    {
+        return c - '0' + 27;
+    }
+
+    return 37 + c % 27;
+}
+
+
+/**
+ * @function name_trigrams
+ *
+ * @brief Calculate trigrams of a folded name
+ *
+ * @discussion
+ * <p>The name is padded with two spaces at the beginning and one space at the end, so short names
+ * and word beginnings have trigrams too. Trigrams are returned sorted and without duplicates.
+ *
+ * @param folded is the folded name
+ * @param grams is the buffer to write trigrams, it must hold strlen(folded) + 2 values
+ * @return number of trigrams
+ */
+int name_trigrams(char *folded, int *grams)
+{
+    int a;
+    int b;
+    int c;
+    int i;
+    int j;
+    int n;
+    int gram;
+
+    if (*folded == '\0')
+    {
+        return 0;
+    }
+
+    a = 0;
+    b = 0;
+    n = 0;
+
+    for (i = 0; ; i++)
+    {
+        c = (folded[i] == '\0') ? 0 : trigram_symbol((unsigned char) folded[i]);
+        gram = (a << (2 * TRIGRAM_BITS)) | (b << TRIGRAM_BITS) | c;
+
+        /* Insertion sort, names are short */
+        j = n;
+        while (j > 0 && grams[j - 1] > gram)
+        {
+            grams[j] = grams[j - 1];
+            j--;
+        }
+
+        if (j > 0 && grams[j - 1] == gram)
+        {
+            memmove(&grams[j], &grams[j + 1], (n - j) * sizeof(int));
+        }
+        else
+        {
+            grams[j] = gram;
+            n++;
+        }
+
+        if (folded[i] == '\0')
+        {
+            break;
+        }
+
+        a = b;
+        b = c;
+    }
+
+    return n;
+}
+
+
+/**
+ * @function compare_folded_keys
+ *
+ * @brief Compare function of struct FoldedKey for qsort
+ */
+static int compare_folded_keys(const void *x, const void *y)
+{
+    const struct FoldedKey *a = x;
+    const struct FoldedKey *b = y;
+    int result;
+
+    result = strcmp(a->key, b->key);
+
+    return (result != 0) ? result : a->id - b->id;
+}
+
+
+/**
+ * @function build_name_index
+ *
+ * @brief Initialize a new instance of struct NameIndex
+ *
+ * @discussion
+ * <p>This function folds every actor name of the graph, sorts folded names for prefix lookups and
+ * builds trigram lists. Lists are filled in id order, so every list is sorted.
+ *
+ * @param g is the graph holds actor names
+ * @return pointer to NameIndex instance
+ */
+struct NameIndex *build_name_index(struct Graph *g)
+{
+    struct NameIndex *index;
+    struct FoldedKey *keys;
+    char buffer[FOLD_BUFFER_SIZE];
+    int grams[FOLD_BUFFER_SIZE + 2];
+    long total;
+    int *fill;
+    int len;
+    int n;
+    int i;
+    int j;
+
+    index = malloc(sizeof(struct NameIndex));
+    index->name_count = g->actor_count;
+    index->folded_offsets = malloc((g->actor_count + 1) * sizeof(int));
+
+    /* First pass: total folded size */
+    total = 0;
+    for (i = 0; i < g->actor_count; i++)
+    {
+        index->folded_offsets[i] = (int) total;
+        total += fold_name(g->actor_names[i], buffer, FOLD_BUFFER_SIZE) + 1;
+    }
+    index->folded_offsets[g->actor_count] = (int) total;
+
+    index->folded = malloc(total + 1);
+    index->gram_offsets = calloc(TRIGRAM_SPACE + 1, sizeof(int));
+
+    if (index->folded == NULL || index->gram_offsets == NULL)
+    {
+        fprintf(stderr, "Name index allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Second pass: store folded names and count trigram list sizes */
+    for (i = 0; i < g->actor_count; i++)
+    {
+        fold_name(g->actor_names[i], index->folded + index->folded_offsets[i], FOLD_BUFFER_SIZE);
+        n = name_trigrams(index->folded + index->folded_offsets[i], grams);
+
+        for (j = 0; j < n; j++)
+        {
+            index->gram_offsets[grams[j] + 1]++;
+        }
+    }
+
+    for (i = 0; i < TRIGRAM_SPACE; i++)
+    {
+        index->gram_offsets[i + 1] += index->gram_offsets[i];
+    }
+
+    /* Third pass: fill trigram lists */
+    index->gram_postings = malloc((index->gram_offsets[TRIGRAM_SPACE] + 1) * sizeof(int));
+    fill = malloc(TRIGRAM_SPACE * sizeof(int));
+    memcpy(fill, index->gram_offsets, TRIGRAM_SPACE * sizeof(int));
+
+    for (i = 0; i < g->actor_count; i++)
+    {
+        n = name_trigrams(index->folded + index->folded_offsets[i], grams);
+
+        for (j = 0; j < n; j++)
+        {
+            index->gram_postings[fill[grams[j]]++] = i;
+        }
+    }
+
+    free(fill);
+
+    /* Prefix index */
+    keys = malloc((g->actor_count + 1) * sizeof(struct FoldedKey));
+    for (i = 0; i < g->actor_count; i++)
+    {
+        keys[i].key = index->folded + index->folded_offsets[i];
+        keys[i].id = i;
+    }
+
+    qsort(keys, g->actor_count, sizeof(struct FoldedKey), compare_folded_keys);
+
+    index->sorted_ids = malloc((g->actor_count + 1) * sizeof(int));
+    for (i = 0; i < g->actor_count; i++)
+    {
+        index->sorted_ids[i] = keys[i].id;
+    }
+
+    free(keys);
+
+    /* Query scratch */
+    len = g->actor_count + 1;
+    index->stamps = calloc(len, sizeof(unsigned int));
+    index->hits = malloc(len * sizeof(int));
+    index->candidates = malloc(len * sizeof(int));
+    index->order = malloc(len * sizeof(int));
+    index->epoch = 0;
+
+    if (index->gram_postings == NULL || index->sorted_ids == NULL || index->stamps == NULL ||
+        index->hits == NULL || index->candidates == NULL || index->order == NULL)
+    {
+        fprintf(stderr, "Name index allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Touch scratch pages now, not at the first query */
+    memset(index->stamps, 0, len * sizeof(unsigned int));
+    memset(index->hits, 0, len * sizeof(int));
+    memset(index->candidates, 0, len * sizeof(int));
+    memset(index->order, 0, len * sizeof(int));
+
+    return index;
+}
+
+
+/**
+ * @function free_name_index
+ *
+ * @brief Free a struct NameIndex instance
+ *
+ * @param index is the index to free
+ */
+void free_name_index(struct NameIndex *index)
+{
+    free(index->folded);
+    free(index->folded_offsets);
+    free(index->sorted_ids);
+    free(index->gram_offsets);
+    free(index->gram_postings);
+    free(index->stamps);
+    free(index->hits);
+    free(index->candidates);
+    free(index->order);
+    free(index);
+}
+
+
+/**
+ * @function complete_name
+ *
+ * @brief Find names beginning with a prefix
+ *
+ * @discussion
+ * <p>This function folds the prefix, finds the first folded name not less than the prefix with
+ * binary search and returns following names while they begin with the prefix.
+ *
+ * @param index is the name index
+ * @param prefix is the beginning of the name
+ * @param ids is the buffer to write actor ids
+ * @param k is the maximum number of names to return
+ * @return number of names found
+ */
+int complete_name(struct NameIndex *index, char *prefix, int *ids, int k)
+{
+    char folded[FOLD_BUFFER_SIZE];
+    int len;
+    int low;
+    int high;
+    int mid;
+    int count;
+
+    len = fold_name(prefix, folded, FOLD_BUFFER_SIZE);
+    low = 0;
+    high = index->name_count;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+
+        if (strcmp(index->folded + index->folded_offsets[index->sorted_ids[mid]], folded) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    count = 0;
+    while (low < index->name_count && count < k &&
+           strncmp(index->folded + index->folded_offsets[index->sorted_ids[low]], folded, len) == 0)
+    {
+        ids[count++] = index->sorted_ids[low++];
+    }
+
+    return count;
+}
+
+
+/**
+ * @function suggest_names
+ *
+ * @brief Find names similar to a possibly misspelled name
+ *
+ * @discussion
+ * <p>Similarity is the Dice coefficient of trigram sets. Candidates are collected from the rarest
+ * SUGGEST_PROBE_LISTS trigram lists of the query, so a name sharing all but a few trigrams with the
+ * query is always a candidate while frequent trigrams are never scanned. Lists after the rarest one
+ * are skipped when they would exceed SUGGEST_POSTING_BUDGET scanned ids. Candidates are then
+ * verified in the order of their hit counts. Verification stops when the best possible score of the
+ * remaining candidates can not enter top k, or after SUGGEST_VERIFY_LIMIT candidates so the query
+ * time is bounded even when every trigram of the query is common.
+ *
+ * @param index is the name index
+ * @param query is the name to search
+ * @param ids is the buffer to write actor ids
+ * @param scores is the buffer to write similarity scores between 0 and 1
+ * @param k is the maximum number of names to return
+ * @return number of names found
+ */
+int suggest_names(struct NameIndex *index, char *query, int *ids, double *scores, int k)
+{
+    char folded[FOLD_BUFFER_SIZE];
+    int query_grams[FOLD_BUFFER_SIZE + 2];
+    int probe[FOLD_BUFFER_SIZE + 2];
+    int grams[FOLD_BUFFER_SIZE + 2];
+    int bucket_start[SUGGEST_PROBE_LISTS + 2];
+    int t;
+    int p;
+    int n;
+    int i;
+    int j;
+    int id;
+    int gram;
+    int shared;
+    int upper;
+    int scanned;
+    int candidate_count;
+    int count;
+    double score;
+
+    if (k <= 0 || index->name_count == 0)
+    {
+        return 0;
+    }
+
+    fold_name(query, folded, FOLD_BUFFER_SIZE);
+    t = name_trigrams(folded, query_grams);
+
+    if (t == 0)
+    {
+        return 0;
+    }
+
+    /* Order query trigrams by list length */
+    for (i = 0; i < t; i++)
+    {
+        gram = query_grams[i];
+        j = i;
+
+        while (j > 0 && index->gram_offsets[probe[j - 1] + 1] - index->gram_offsets[probe[j - 1]] >
+                        index->gram_offsets[gram + 1] - index->gram_offsets[gram])
+        {
+            probe[j] = probe[j - 1];
+            j--;
+        }
+
+        probe[j] = gram;
+    }
+
+    p = (t < SUGGEST_PROBE_LISTS) ? t : SUGGEST_PROBE_LISTS;
+
+    index->epoch++;
+    if (index->epoch == 0)
+    {
+        memset(index->stamps, 0, index->name_count * sizeof(unsigned int));
+        index->epoch = 1;
+    }
+
+    /* Collect candidates from the rarest lists */
+    candidate_count = 0;
+    scanned = 0;
+    for (i = 0; i < p; i++)
+    {
+        scanned += index->gram_offsets[probe[i] + 1] - index->gram_offsets[probe[i]];
+
+        if (i > 0 && scanned > SUGGEST_POSTING_BUDGET)
+        {
+            p = i;
+            break;
+        }
+
+        for (j = index->gram_offsets[probe[i]]; j < index->gram_offsets[probe[i] + 1]; j++)
+        {
+            id = index->gram_postings[j];
+
+            if (index->stamps[id] != index->epoch)
+            {
+                index->stamps[id] = index->epoch;
+                index->hits[id] = 0;
+                index->candidates[candidate_count++] = id;
+            }
+
+            index->hits[id]++;
+        }
+    }
+
+    /* Counting sort candidates by hits, descending */
+    memset(bucket_start, 0, sizeof(bucket_start));
+    for (i = 0; i < candidate_count; i++)
+    {
+        bucket_start[p - index->hits[index->candidates[i]] + 1]++;
+    }
+
+    for (i = 0; i <= p; i++)
+    {
+        bucket_start[i + 1] += bucket_start[i];
+    }
+
+    for (i = 0; i < candidate_count; i++)
+    {
+        id = index->candidates[i];
+        index->order[bucket_start[p - index->hits[id]]++] = id;
+    }
+
+    /* Verify candidates */
+    count = 0;
+    for (i = 0; i < candidate_count && i < SUGGEST_VERIFY_LIMIT; i++)
+    {
+        id = index->order[i];
+        upper = index->hits[id] + (t - p);
+
+        if (count == k && 2.0 * upper / (t + upper) < scores[k - 1])
+        {
+            break;
+        }
+
+        n = name_trigrams(index->folded + index->folded_offsets[id], grams);
+
+        shared = 0;
+        j = 0;
+        gram = 0;
+        while (j < n && gram < t)
+        {
+            if (grams[j] == query_grams[gram])
+            {
+                shared++;
+                j++;
+                gram++;
+            }
+            else if (grams[j] < query_grams[gram])
+            {
+                j++;
+            }
+            else
+            {
+                gram++;
+            }
+        }
+
+        score = 2.0 * shared / (t + n);
+
+        if (count == k && score <= scores[k - 1])
+        {
+            continue;
+        }
+
+        /* Insert into top k */
+        j = (count < k) ? count++ : k - 1;
+        while (j > 0 && scores[j - 1] < score)
+        {
+            scores[j] = scores[j - 1];
+            ids[j] = ids[j - 1];
+            j--;
+        }
+
+        scores[j] = score;
+        ids[j] = id;
+    }
+
+    return count;
+}
+
+
+/**
+ * @function print_suggestions
+ *
+ * @brief Print similar names when a name is not in the graph
+ *
+ * @param index is the name index
+ * @param g is the graph holds actor names
+ * @param name is the name user entered
+ */
+void print_suggestions(struct NameIndex *index, struct Graph *g, char *name)
+{
+    int ids[SUGGESTION_COUNT];
+    double scores[SUGGESTION_COUNT];
+    int count;
+    int i;
+
+    count = suggest_names(index, name, ids, scores, SUGGESTION_COUNT);
+
+    for (i = 0; i < count; i++)
+    {
+        if (strcmp(g->actor_names[ids[i]], name) == 0)
+        {
+            return;
+        }
+    }
+
+    if (count > 0)
+    {
+        printf("Did you mean (for \"%s\"):\n", name);
+
+        for (i = 0; i < count; i++)
+        {
+            printf("  %s\n", g->actor_names[ids[i]]);
+        }
+    }
+}
+
+
+/**
+ * @function create_search_filter
+ *
+ * @brief Initialize a new instance of struct SearchFilter
+ *
+ * @discussion
+ * <p>This function allocates an empty filter: no year limits and empty excluded sets.
+ *
+ * @param g is the graph to filter
+ * @return pointer to SearchFilter instance
+ */
+struct SearchFilter *create_search_filter(struct Graph *g)
+{
+    struct SearchFilter *f;
+
+    f = malloc(sizeof(struct SearchFilter));
+
+    f->min_year = 0;
+    f->max_year = 0;
+    f->excluded_actors = calloc(BITSET_WORDS(g->actor_count) + 1, sizeof(unsigned long));
+    f->excluded_movies = calloc(BITSET_WORDS(g->movie_count) + 1, sizeof(unsigned long));
+
+    if (f->excluded_actors == NULL || f->excluded_movies == NULL)
+    {
+        fprintf(stderr, "Filter allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return f;
+}
+
+
+/**
+ * @function free_search_filter
+ *
+ * @brief Free a struct SearchFilter instance
+ *
+ * @param f is the filter to free
+ */
+void free_search_filter(struct SearchFilter *f)
+{
+    free(f->excluded_actors);
+    free(f->excluded_movies);
+    free(f);
+}
+
+
+/**
+ * @function movie_allowed
+ *
+ * @brief Check a movie against a filter
+ *
+ * @discussion
+ * <p>A movie without a year never passes a year limit.
+ *
+ * @param g is the graph
+ * @param f is the filter, NULL for no filter
+ * @param m is the movie id
+ * @return 1 if a path can pass through the movie, 0 otherwise
+ */
+static int movie_allowed(struct Graph *g, struct SearchFilter *f, int m)
+{
+    int year;
+
+    if (f == NULL)
+    {
+        return 1;
+    }
+
+    year = g->movie_years[m];
+
+    if ((f->min_year != 0 && year < f->min_year) || (f->max_year != 0 && (year == 0 || year > f->max_year)))
+    {
+        return 0;
+    }
+
+    return !BITSET_TEST(f->excluded_movies, m);
+}
+
+
+/**
+ * @function actor_allowed
+ *
+ * @brief Check an actor against a filter
+ *
+ * @param f is the filter, NULL for no filter
+ * @param a is the actor id
+ * @return 1 if a path can pass through the actor, 0 otherwise
+ */
+static int actor_allowed(struct SearchFilter *f, int a)
+{
+    return f == NULL || !BITSET_TEST(f->excluded_actors, a);
+}
+
+
+/**
+ * @function create_search_context
+ *
+ * @brief Initialize a new instance of struct SearchContext
+ *
+ * @param g is the graph to search on
+ * @return pointer to SearchContext instance
+ */
+struct SearchContext *create_search_context(struct Graph *g)
+{
+    struct SearchContext *ctx;
+
+    ctx = malloc(sizeof(struct SearchContext));
+
+    ctx->graph = g;
+    ctx->queue = malloc((g->actor_count + 1) * sizeof(int));
+    ctx->parent = malloc((g->actor_count + 1) * sizeof(int));
+    ctx->parent_movie = malloc((g->actor_count + 1) * sizeof(int));
+    ctx->actor_stamps = calloc(g->actor_count + 1, sizeof(unsigned int));
+    ctx->movie_stamps = calloc(g->movie_count + 1, sizeof(unsigned int));
+    ctx->epoch = 0;
+    ctx->movie_queue = malloc((g->movie_count + 1) * sizeof(int));
+    ctx->actor_level = malloc((g->actor_count + 1) * sizeof(int));
+    ctx->movie_level = malloc((g->movie_count + 1) * sizeof(int));
+    ctx->actor_paths = malloc((g->actor_count + 1) * sizeof(uint64_t));
+    ctx->movie_paths = malloc((g->movie_count + 1) * sizeof(uint64_t));
+    ctx->batch_movies_capacity = BFS_QUEUE_SIZE;
+    ctx->batch_movies = malloc(ctx->batch_movies_capacity * sizeof(int));
+    ctx->batch_cast_capacity = BFS_QUEUE_SIZE;
+    ctx->batch_cast = malloc(ctx->batch_cast_capacity * sizeof(int));
+    ctx->timeout = 0;
+    ctx->max_expanded = 0;
+    ctx->cancel = NULL;
+    ctx->deadline = 0;
+    ctx->expanded = 0;
+    ctx->lower_bound = 0;
+
+    if (ctx->queue == NULL || ctx->parent == NULL || ctx->parent_movie == NULL ||
+        ctx->actor_stamps == NULL || ctx->movie_stamps == NULL || ctx->movie_queue == NULL ||
+        ctx->actor_level == NULL || ctx->movie_level == NULL || ctx->actor_paths == NULL ||
+        ctx->movie_paths == NULL || ctx->batch_movies == NULL || ctx->batch_cast == NULL)
+    {
+        fprintf(stderr, "Search context allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return ctx;
+}
+
+
+/**
+ * @function free_search_context
+ *
+ * @brief Free a struct SearchContext instance
+ *
+ * @param ctx is the context to free
+ */
+void free_search_context(struct SearchContext *ctx)
+{
+    free(ctx->queue);
+    free(ctx->parent);
+    free(ctx->parent_movie);
+    free(ctx->actor_stamps);
+    free(ctx->movie_stamps);
+    free(ctx->movie_queue);
+    free(ctx->actor_level);
+    free(ctx->movie_level);
+    free(ctx->actor_paths);
+    free(ctx->movie_paths);
+    free(ctx->batch_movies);
+    free(ctx->batch_cast);
+    free(ctx);
+}
+
+
+/**
+ * @function begin_search
+ *
+ * @brief Start a new search on a context
+ *
+ * @discussion
+ * <p>This function moves to the next epoch, so every node becomes not visited. Stamps are cleared
+ * only when the epoch counter wraps around. The deadline of the search starts here. The cancel flag
+ * is left to its owner, a flag set before the search stops it at once.
+ *
+ * @param ctx is the search context
+ */
+void begin_search(struct SearchContext *ctx)
+{
+    ctx->epoch++;
+    ctx->expanded = 0;
+    ctx->lower_bound = 0;
+    ctx->deadline = (ctx->timeout > 0) ? now_seconds() + ctx->timeout : 0;
+
+    if (ctx->epoch == 0)
+    {
+        memset(ctx->actor_stamps, 0, ctx->graph->actor_count * sizeof(unsigned int));
+        memset(ctx->movie_stamps, 0, ctx->graph->movie_count * sizeof(unsigned int));
+        ctx->epoch = 1;
+    }
+}
+
+
+/**
+ * @function set_search_limits
+ *
+ * @brief Limit the time and work of the searches of a context
+ *
+ * @discussion
+ * <p>find_distance_filtered, count_shortest_paths, expand_neighborhood and find_strongest_link
+ * return SEARCH_STOPPED when a limit is reached. The cancel flag is read while searching, so it can be
+ * set by a signal handler or another thread while a search runs.
+ *
+ * @param ctx is the search context
+ * @param timeout is the time a search may take in seconds, 0 for no limit
+ * @param max_expanded is the number of actors a search may expand, 0 for no limit
+ * @param cancel is the flag that stops a search, NULL for none
+ */
+void set_search_limits(struct SearchContext *ctx, double timeout, long max_expanded, volatile sig_atomic_t *cancel)
+{
+    ctx->timeout = timeout;
+    ctx->max_expanded = max_expanded;
+    ctx->cancel = cancel;
+}
+
+
+/**
+ * @function search_stopped
+ *
+ * @brief Count an expanded actor and check the limits of the search
+ *
+ * @discussion
+ * <p>The clock is read once every SEARCH_CLOCK_INTERVAL actors.
+ *
+ * @param ctx is the search context
+ * @return 1 if the search must stop, 0 otherwise
+ */
+static int search_stopped(struct SearchContext *ctx)
+{
+    ctx->expanded++;
+
+    return (ctx->cancel != NULL && *ctx->cancel) ||
+           (ctx->max_expanded > 0 && ctx->expanded > ctx->max_expanded) ||
+           (ctx->deadline > 0 && ctx->expanded % SEARCH_CLOCK_INTERVAL == 0 && now_seconds() > ctx->deadline);
+}
+
+
+/**
+ * @function find_distance_filtered
+ *
+ * @brief Find the distance of an actor to another under constraints
+ *
+ * @discussion
+ * <p>This function runs BFS on the graph. Movies and actors rejected by the filter are skipped
+ * while expanding, so no filtered copy of the graph is built. After a successful search the path
+ * can be printed with print_path. Actors of different components return -1 without a search. If a
+ * limit stops the search after the ending actor is reached, its distance is returned anyway.
+ *
+ * @param ctx is the search context
+ * @param start is the id of the starting actor
+ * @param end is the id of the ending actor
+ * @param filter is the constraints of the path, NULL for no constraints
+ * @return distance value, -1 if there is no connection, SEARCH_STOPPED if a limit is reached, the
+ * distance is at least lower_bound of the context then
+ */
+int find_distance_filtered(struct SearchContext *ctx, int start, int end, struct SearchFilter *filter)
+{
+    struct Graph *g;
+    int head;
+    int tail;
+    int level_end;
+    int level;
+    int a;
+    int m;
+    int b;
+    int i;
+    int j;
+
+    g = ctx->graph;
+
+    if (!actor_allowed(filter, start) || !actor_allowed(filter, end) ||
+        g->actor_components[start] != g->actor_components[end])
+    {
+        return -1;
+    }
+
+    begin_search(ctx);
+
+    ctx->actor_stamps[start] = ctx->epoch;
+    ctx->parent[start] = -1;
+    ctx->parent_movie[start] = -1;
+    ctx->queue[0] = start;
+
+    head = 0;
+    tail = 1;
+    level = 0;
+    level_end = tail;
+
+    while (head < tail)
+    {
+        if (head == level_end)
+        {
+            level++;
+            level_end = tail;
+        }
+
+        a = ctx->queue[head++];
+
+        if (a == end)
+        {
+            return level;
+        }
+
+        if (search_stopped(ctx))
+        {
+            /* A reached actor's parent chain is a shortest path */
+            if (ctx->actor_stamps[end] == ctx->epoch)
+            {
+                for (level = 0, a = end; ctx->parent[a] != -1; a = ctx->parent[a])
+                {
+                    level++;
+                }
+
+                return level;
+            }
+
+            /* Every actor of this level is reached already */
+            ctx->lower_bound = level + 1;
+            return SEARCH_STOPPED;
+        }
+
+        for (i = g->actor_offsets[a]; i < g->actor_offsets[a + 1]; i++)
+        {
+            m = g->actor_movies[i];
+
+            if (ctx->movie_stamps[m] == ctx->epoch || !movie_allowed(g, filter, m))
+            {
+                continue;
+            }
+
+            ctx->movie_stamps[m] = ctx->epoch;
+
+            for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+            {
+                b = g->movie_actors[j];
+
+                if (ctx->actor_stamps[b] != ctx->epoch && actor_allowed(filter, b))
+                {
+                    ctx->actor_stamps[b] = ctx->epoch;
+                    ctx->parent[b] = a;
+                    ctx->parent_movie[b] = m;
+                    ctx->queue[tail++] = b;
+                }
+            }
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @function print_path
+ *
+ * @brief Print the path found by the last search
+ *
+ * @discussion
+ * <p>The path is printed from the ending actor back to the starting actor, in the same format
+ * find_distance uses.
+ *
+ * @param ctx is the search context
+ * @param end is the id of the ending actor
+ */
+void print_path(struct SearchContext *ctx, int end)
+{
+    struct Graph *g;
+    int a;
+
+    g = ctx->graph;
+
+    for (a = end; ctx->parent[a] != -1; a = ctx->parent[a])
+    {
+        printf("%s - %s: \"%s\"\n", g->actor_names[a], g->actor_names[ctx->parent[a]],
+               g->movie_names[ctx->parent_movie[a]]);
+    }
+}
+
+
+/**
+ * @function read_line
+ *
+ * @brief Read a line from stdin
+ *
+ * @discussion
+ * <p>Unlike scanf, this function accepts empty lines. The new line character is removed.
+ *
+ * @param buffer is the buffer to write the line
+ * @param size is the size of the buffer
+ * @return length of the line, -1 at the end of input
+ */
+int read_line(char *buffer, int size)
+{
+    int len;
+
+    if (fgets(buffer, size, stdin) == NULL)
+    {
+        buffer[0] = '\0';
+        return -1;
+    }
+
+    len = (int) strlen(buffer);
+
+    while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r'))
+    {
+        buffer[--len] = '\0';
+    }
+
+    return len;
+}
+
+
+/**
+ * @function find_actor_id
+ *
+ * @brief Find the graph id of an actor by name
+ *
+ * @param actors is the actors hash table
+ * @param name is the name of the actor
+ * @return id of the actor, -1 if it is not in the table
+ */
+int find_actor_id(struct HashTable *actors, char *name)
+{
+    struct MapEntry *e;
+
+    e = search(actors, hash(name));
+
+    return (e == NULL) ? -1 : ((struct Actor *) e->value)->id;
+}
+
+
+/**
+ * @function find_movie_id
+ *
+ * @brief Find the graph id of a movie by name
+ *
+ * @param movies is the movies hash table
+ * @param name is the name of the movie
+ * @return id of the movie, -1 if it is not in the table
+ */
+int find_movie_id(struct HashTable *movies, char *name)
+{
+    struct MapEntry *e;
+
+    e = search(movies, hash(name));
+
+    return (e == NULL) ? -1 : ((struct Movie *) e->value)->id;
+}
+
+
+/**
+ * @function read_exclusions
+ *
+ * @brief Add names of a list to an excluded set
+ *
+ * @discussion
+ * <p>Names are separated by TOKEN_DELIMITER, like in the input file. Unknown names are reported
+ * and ignored.
+ *
+ * @param list is the string of names, it is modified while tokenizing
+ * @param ht is the hash table to look names up
+ * @param is_movie_table is 1 if ht is the movies table, 0 if it is the actors table
+ * @param set is the bitset to add ids
+ */
+void read_exclusions(char *list, struct HashTable *ht, int is_movie_table, unsigned long *set)
+{
+    char **tokens;
+    int id;
+    int i;
+
+    tokens = parse_line(list);
+
+    for (i = 0; tokens[i] != NULL; i++)
+    {
+        id = is_movie_table ? find_movie_id(ht, tokens[i]) : find_actor_id(ht, tokens[i]);
+
+        if (id == -1)
+        {
+            printf("Not found, ignored: %s\n", tokens[i]);
+        }
+        else
+        {
+            BITSET_SET(set, id);
+        }
+    }
+
+    free(tokens);
+}
+
+
+/**
+ * @function saturating_add
+ *
+ * @brief Add two path counts
+ *
+ * @return sum of the counts, or UINT64_MAX if the sum does not fit
+ */
+static uint64_t saturating_add(uint64_t x, uint64_t y)
+{
+    return (x > UINT64_MAX - y) ? UINT64_MAX : x + y;
+}
+
+
+/**
+ * @function count_shortest_paths
+ *
+ * @brief Count every shortest path between two actors
+ *
+ * @discussion
+ * <p>This function runs a level synchronous BFS. Actors of a level first push their path counts to
+ * their movies, then movies reached at that level push their counts to actors of the next level, so
+ * every movie is expanded once. The search stops when the level of the ending actor is complete. Levels
+ * and counts are left in the context for struct PathCursor. Counts saturate at UINT64_MAX.
+ *
+ * @param ctx is the search context
+ * @param start is the id of the starting actor
+ * @param end is the id of the ending actor
+ * @param filter is the constraints of the paths, NULL for no constraints
+ * @param count is the number of shortest paths, UINT64_MAX if it does not fit
+ * @return distance value, -1 if there is no connection, SEARCH_STOPPED if a limit is reached, the
+ * distance is at least lower_bound of the context then
+ */
+int count_shortest_paths(struct SearchContext *ctx, int start, int end, struct SearchFilter *filter,
+                         uint64_t *count)
+{
+    struct Graph *g;
+    int head;
+    int tail;
+    int level_end;
+    int movie_tail;
+    int level;
+    int a;
+    int m;
+    int b;
+    int i;
+    int j;
+
+    g = ctx->graph;
+    *count = 0;
+
+    if (!actor_allowed(filter, start) || !actor_allowed(filter, end) ||
+        g->actor_components[start] != g->actor_components[end])
+    {
+        return -1;
+    }
+
+    begin_search(ctx);
+
+    ctx->actor_stamps[start] = ctx->epoch;
+    ctx->actor_level[start] = 0;
+    ctx->actor_paths[start] = 1;
+    ctx->queue[0] = start;
+
+    head = 0;
+    tail = 1;
+    level = 0;
+
+    while (ctx->actor_stamps[end] != ctx->epoch && head < tail)
+    {
+        level_end = tail;
+        movie_tail = 0;
+
+        /* Actors of this level to their movies */
+        for (; head < level_end; head++)
+        {
+            a = ctx->queue[head];
+
+            if (search_stopped(ctx))
+            {
+                ctx->lower_bound = level + 1;
+                return SEARCH_STOPPED;
+            }
+
+            for (i = g->actor_offsets[a]; i < g->actor_offsets[a + 1]; i++)
+            {
+                m = g->actor_movies[i];
+
+                if (ctx->movie_stamps[m] != ctx->epoch)
+                {
+                    if (!movie_allowed(g, filter, m))
+                    {
+                        continue;
+                    }
+
+                    ctx->movie_stamps[m] = ctx->epoch;
+                    ctx->movie_level[m] = level;
+                    ctx->movie_paths[m] = 0;
+                    ctx->movie_queue[movie_tail++] = m;
+                }
+
+                if (ctx->movie_level[m] == level)
+                {
+                    ctx->movie_paths[m] = saturating_add(ctx->movie_paths[m], ctx->actor_paths[a]);
+                }
+            }
+        }
+
+        /* Movies of this level to actors of the next level */
+        for (i = 0; i < movie_tail; i++)
+        {
+            m = ctx->movie_queue[i];
+
+            for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+            {
+                b = g->movie_actors[j];
+
+                if (ctx->actor_stamps[b] != ctx->epoch)
+                {
+                    if (!actor_allowed(filter, b))
+                    {
+                        continue;
+                    }
+
+                    ctx->actor_stamps[b] = ctx->epoch;
+                    ctx->actor_level[b] = level + 1;
+                    ctx->actor_paths[b] = 0;
+                    ctx->queue[tail++] = b;
+                }
+
+                if (ctx->actor_level[b] == level + 1)
+                {
+                    ctx->actor_paths[b] = saturating_add(ctx->actor_paths[b], ctx->movie_paths[m]);
+                }
+            }
+        }
+
+        level++;
+    }
+
+    if (ctx->actor_stamps[end] != ctx->epoch)
+    {
+        return -1;
+    }
+
+    *count = ctx->actor_paths[end];
+
+    return ctx->actor_level[end];
+}
+
+
+/**
+ * @function create_path_cursor
+ *
+ * @brief Initialize a new instance of struct PathCursor
+ *
+ * @discussion
+ * <p>The cursor reads the DAG of the last count_shortest_paths call on the context, so it must be
+ * used before the context runs another search. Call path_cursor_seek before reading paths.
+ *
+ * @param ctx is the search context
+ * @param end is the id of the ending actor
+ * @param distance is the distance count_shortest_paths returned
+ * @return pointer to PathCursor instance
+ */
+struct PathCursor *create_path_cursor(struct SearchContext *ctx, int end, int distance)
+{
+    struct PathCursor *c;
+
+    c = malloc(sizeof(struct PathCursor));
+
+    c->ctx = ctx;
+    c->distance = distance;
+    c->actors = malloc((distance + 1) * sizeof(int));
+    c->movies = malloc((distance + 1) * sizeof(int));
+    c->movie_pos = malloc((distance + 1) * sizeof(int));
+    c->actor_pos = malloc((distance + 1) * sizeof(int));
+    c->actors[0] = end;
+
+    return c;
+}
+
+
+/**
+ * @function free_path_cursor
+ *
+ * @brief Free a struct PathCursor instance
+ *
+ * @param c is the cursor to free
+ */
+void free_path_cursor(struct PathCursor *c)
+{
+    free(c->actors);
+    free(c->movies);
+    free(c->movie_pos);
+    free(c->actor_pos);
+    free(c);
+}
+
+
+/**
+ * @function next_dag_movie
+ *
+ * @brief Find the next movie linking actors[i] of a cursor to the previous level
+ *
+ * @param c is the cursor
+ * @param i is the depth on the path
+ * @param pos is the position in the actor row to start from
+ * @return position of the movie in the actor row, -1 if there is not any
+ */
+static int next_dag_movie(struct PathCursor *c, int i, int pos)
+{
+    struct SearchContext *ctx;
+    struct Graph *g;
+    int level;
+    int m;
+
+    ctx = c->ctx;
+    g = ctx->graph;
+    level = c->distance - i - 1;
+
+    for (; pos < g->actor_offsets[c->actors[i] + 1]; pos++)
+    {
+        m = g->actor_movies[pos];
+
+        if (ctx->movie_stamps[m] == ctx->epoch && ctx->movie_level[m] == level)
+        {
+            return pos;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @function next_dag_actor
+ *
+ * @brief Find the next actor of movies[i] of a cursor on the previous level
+ *
+ * @param c is the cursor
+ * @param i is the depth on the path
+ * @param pos is the position in the movie row to start from
+ * @return position of the actor in the movie row, -1 if there is not any
+ */
+static int next_dag_actor(struct PathCursor *c, int i, int pos)
+{
+    struct SearchContext *ctx;
+    struct Graph *g;
+    int level;
+    int a;
+
+    ctx = c->ctx;
+    g = ctx->graph;
+    level = c->distance - i - 1;
+
+    for (; pos < g->movie_offsets[c->movies[i] + 1]; pos++)
+    {
+        a = g->movie_actors[pos];
+
+        if (ctx->actor_stamps[a] == ctx->epoch && ctx->actor_level[a] == level)
+        {
+            return pos;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @function descend_first
+ *
+ * @brief Complete a cursor path from depth i with the first choices
+ *
+ * @discussion
+ * <p>Every node of the DAG except the starting actor has a predecessor, so this always succeeds.
+ *
+ * @param c is the cursor
+ * @param i is the depth of the last fixed actor
+ */
+static void descend_first(struct PathCursor *c, int i)
+{
+    struct Graph *g;
+
+    g = c->ctx->graph;
+
+    for (; i < c->distance; i++)
+    {
+        c->movie_pos[i] = next_dag_movie(c, i, g->actor_offsets[c->actors[i]]);
+        c->movies[i] = g->actor_movies[c->movie_pos[i]];
+        c->actor_pos[i] = next_dag_actor(c, i, g->movie_offsets[c->movies[i]]);
+        c->actors[i + 1] = g->movie_actors[c->actor_pos[i]];
+    }
+}
+
+
+/**
+ * @function path_cursor_seek
+ *
+ * @brief Move a cursor to a path number
+ *
+ * @discussion
+ * <p>At every depth the cursor skips whole sub-DAGs using their path counts, so seeking costs the
+ * sum of row lengths on one path however many paths are skipped. A saturated count is larger than
+ * every path number, so the cursor descends into it.
+ *
+ * @param c is the cursor
+ * @param number is the path number, starting from 0
+ * @return 1 if the path exists, 0 otherwise
+ */
+int path_cursor_seek(struct PathCursor *c, uint64_t number)
+{
+    struct SearchContext *ctx;
+    struct Graph *g;
+    int pos;
+    int i;
+
+    ctx = c->ctx;
+    g = ctx->graph;
+
+    if (number >= ctx->actor_paths[c->actors[0]])
+    {
+        return 0;
+    }
+
+    for (i = 0; i < c->distance; i++)
+    {
+        pos = g->actor_offsets[c->actors[i]];
+
+        while ((pos = next_dag_movie(c, i, pos)) != -1 && number >= ctx->movie_paths[g->actor_movies[pos]])
+        {
+            number -= ctx->movie_paths[g->actor_movies[pos]];
+            pos++;
+        }
+
+        if (pos == -1)
+        {
+            return 0;
+        }
+
+        c->movie_pos[i] = pos;
+        c->movies[i] = g->actor_movies[pos];
+        pos = g->movie_offsets[c->movies[i]];
+
+        while ((pos = next_dag_actor(c, i, pos)) != -1 && number >= ctx->actor_paths[g->movie_actors[pos]])
+        {
+            number -= ctx->actor_paths[g->movie_actors[pos]];
+            pos++;
+        }
+
+        if (pos == -1)
+        {
+            return 0;
+        }
+
+        c->actor_pos[i] = pos;
+        c->actors[i + 1] = g->movie_actors[pos];
+    }
+
+    return 1;
+}
+
+
+/**
+ * @function path_cursor_next
+ *
+ * @brief Move a cursor to the next path
+ *
+ * @param c is the cursor
+ * @return 1 if there is a next path, 0 otherwise
+ */
+int path_cursor_next(struct PathCursor *c)
+{
+    struct Graph *g;
+    int pos;
+    int i;
+
+    g = c->ctx->graph;
+
+    for (i = c->distance - 1; i >= 0; i--)
+    {
+        /* Another actor in the same movie */
+        pos = next_dag_actor(c, i, c->actor_pos[i] + 1);
+
+        if (pos == -1)
+        {
+            /* Another movie */
+            pos = next_dag_movie(c, i, c->movie_pos[i] + 1);
+
+            if (pos == -1)
+            {
+                continue;
+            }
+
+            c->movie_pos[i] = pos;
+            c->movies[i] = g->actor_movies[pos];
+            pos = next_dag_actor(c, i, g->movie_offsets[c->movies[i]]);
+        }
+
+        c->actor_pos[i] = pos;
+        c->actors[i + 1] = g->movie_actors[pos];
+        descend_first(c, i + 1);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @function print_cursor_path
+ *
+ * @brief Print the current path of a cursor
+ *
+ * @discussion
+ * <p>The path is printed in the same format find_distance uses.
+ *
+ * @param c is the cursor
+ */
+void print_cursor_path(struct PathCursor *c)
+{
+    struct Graph *g;
+    int i;
+
+    g = c->ctx->graph;
+
+    for (i = 0; i < c->distance; i++)
+    {
+        printf("%s - %s: \"%s\"\n", g->actor_names[c->actors[i]], g->actor_names[c->actors[i + 1]],
+               g->movie_names[c->movies[i]]);
+    }
+}
+
+
+/**
+ * @function comes_before
+ *
+ * @brief Order of actors by descending movie count, then by id
+ *
+ * @return 1 if actor a comes before actor b, 0 otherwise
+ */
+static int comes_before(struct Graph *g, int a, int b)
+{
+    int da;
+    int db;
+
+    da = g->actor_offsets[a + 1] - g->actor_offsets[a];
+    db = g->actor_offsets[b + 1] - g->actor_offsets[b];
+
+    return (da != db) ? da > db : a < b;
+}
+
+
+/**
+ * @function sift_down
+ *
+ * @brief Restore the heap property of sort_by_degree
+ */
+static void sift_down(struct Graph *g, int *ids, int root, int n)
+{
+    int child;
+    int tmp;
+
+    while ((child = 2 * root + 1) < n)
+    {
+        if (child + 1 < n && comes_before(g, ids[child], ids[child + 1]))
+        {
+            child++;
+        }
+
+        if (!comes_before(g, ids[root], ids[child]))
+        {
+            return;
+        }
+
+        tmp = ids[root];
+        ids[root] = ids[child];
+        ids[child] = tmp;
+        root = child;
+    }
+}
+
+
+/**
+ * @function sort_by_degree
+ *
+ * @brief Sort actor ids by descending movie count
+ *
+ * @discussion
+ * <p>Heap sort, so the ids are sorted in place without any allocation.
+ *
+ * @param g is the graph
+ * @param ids is the array of actor ids
+ * @param n is the number of ids
+ */
+void sort_by_degree(struct Graph *g, int *ids, int n)
+{
+    int i;
+    int tmp;
+
+    for (i = n / 2 - 1; i >= 0; i--)
+    {
+        sift_down(g, ids, i, n);
+    }
+
+    for (i = n - 1; i > 0; i--)
+    {
+        tmp = ids[0];
+        ids[0] = ids[i];
+        ids[i] = tmp;
+        sift_down(g, ids, 0, i);
+    }
+}
+
+
+/**
+ * @function expand_neighborhood
+ *
+ * @brief Find every actor within a distance of an actor
+ *
+ * @discussion
+ * <p>This function runs BFS level by level and stops after the given depth. When a level is
+ * complete, its actors are passed to visit in chunks of at most NEIGHBORHOOD_CHUNK ids. Chunks point
+ * into the queue of the context, so the result is never copied and visit must not keep the pointer.
+ * Levels are written to actor_level of the context too.
+ *
+ * @param ctx is the search context
+ * @param start is the id of the starting actor
+ * @param depth is the maximum distance
+ * @param filter is the constraints of the paths, NULL for no constraints
+ * @param sorted is 1 to sort every level by descending movie count, 0 for BFS order
+ * @param visit is the function called with level number, level size and a chunk of the level
+ * @param data is passed to visit
+ * @return number of actors found, the starting actor excluded, SEARCH_STOPPED if a limit is reached,
+ * lower_bound of the context is the number of actors of the levels passed to visit then
+ */
+int expand_neighborhood(struct SearchContext *ctx, int start, int depth, struct SearchFilter *filter,
+                        int sorted, void (*visit)(int level, int level_size, int *ids, int count, void *data),
+                        void *data)
+{
+    struct Graph *g;
+    int head;
+    int tail;
+    int level_start;
+    int level;
+    int found;
+    int size;
+    int a;
+    int m;
+    int b;
+    int i;
+    int j;
+
+    g = ctx->graph;
+
+    if (!actor_allowed(filter, start))
+    {
+        return 0;
+    }
+
+    begin_search(ctx);
+
+    ctx->actor_stamps[start] = ctx->epoch;
+    ctx->actor_level[start] = 0;
+    ctx->queue[0] = start;
+
+    head = 0;
+    tail = 1;
+    found = 0;
+
+    for (level = 1; level <= depth && head < tail; level++)
+    {
+        level_start = tail;
+
+        for (; head < level_start; head++)
+        {
+            a = ctx->queue[head];
+
+            if (search_stopped(ctx))
+            {
+                ctx->lower_bound = found;
+                return SEARCH_STOPPED;
+            }
+
+            for (i = g->actor_offsets[a]; i < g->actor_offsets[a + 1]; i++)
+            {
+                m = g->actor_movies[i];
+
+                if (ctx->movie_stamps[m] == ctx->epoch || !movie_allowed(g, filter, m))
+                {
+                    continue;
+                }
+
+                ctx->movie_stamps[m] = ctx->epoch;
+
+                for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+                {
+                    b = g->movie_actors[j];
+
+                    if (ctx->actor_stamps[b] != ctx->epoch && actor_allowed(filter, b))
+                    {
+                        ctx->actor_stamps[b] = ctx->epoch;
+                        ctx->actor_level[b] = level;
+                        ctx->queue[tail++] = b;
+                    }
+                }
+            }
+        }
+
+        size = tail - level_start;
+
+        if (sorted)
+        {
+            sort_by_degree(g, ctx->queue + level_start, size);
+        }
+
+        for (i = 0; i < size; i += NEIGHBORHOOD_CHUNK)
+        {
+            visit(level, size, ctx->queue + level_start + i,
+                  (size - i < NEIGHBORHOOD_CHUNK) ? size - i : NEIGHBORHOOD_CHUNK, data);
+        }
+
+        found += size;
+    }
+
+    return found;
+}
+
+
+/**
+ * @function print_level
+ *
+ * @brief Print a chunk of a neighborhood level
+ *
+ * @discussion
+ * <p>A visit function for expand_neighborhood, data is a struct LevelPrinter.
+ */
+void print_level(int level, int level_size, int *ids, int count, void *data)
+{
+    struct LevelPrinter *printer;
+    int i;
+
+    printer = data;
+
+    if (printer->last_level != level)
+    {
+        printer->last_level = level;
+        printf("Distance %d: %d actors\n", level, level_size);
+    }
+
+    if (printer->print_names)
+    {
+        for (i = 0; i < count; i++)
+        {
+            printf("  %s (%d movies)\n", printer->graph->actor_names[ids[i]],
+                   printer->graph->actor_offsets[ids[i] + 1] - printer->graph->actor_offsets[ids[i]]);
+        }
+    }
+}
+
+
+/**
+ * @function ring_init
+ *
+ * @brief Initialize an empty struct RingQueue
+ *
+ * @param q is the queue to initialize
+ */
+void ring_init(struct RingQueue *q)
+{
+    memset(q, 0, sizeof(struct RingQueue));
+    q->mask = LOADER_QUEUE_SIZE - 1;
+}
+
+
+/**
+ * @function ring_push
+ *
+ * @brief Add an element to a ring queue
+ *
+ * @discussion
+ * <p>If the queue is full, the producer yields until the consumer pops an element. Waiting time
+ * is added to the stall time of the producer stage.
+ *
+ * @param q is the queue to operate on
+ * @param value is the element to add
+ * @param stats is the statistics of the producer stage
+ */
+void ring_push(struct RingQueue *q, void *value, struct StageStats *stats)
+{
+    unsigned long tail;
+    double started;
+
+    tail = q->tail;
+
+    if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask)
+    {
+        started = now_seconds();
+
+        while (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask)
+        {
+            sched_yield();
+        }
+
+        stats->stalled += now_seconds() - started;
+    }
+
+    q->slots[tail & q->mask] = value;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @function ring_pop
+ *
+ * @brief Remove the first element of a ring queue
+ *
+ * @discussion
+ * <p>If the queue is empty, the consumer yields until the producer pushes an element. Waiting time
+ * is added to the stall time of the consumer stage.
+ *
+ * @param q is the queue to operate on
+ * @param stats is the statistics of the consumer stage
+ * @return the first element of the queue
+ */
+void *ring_pop(struct RingQueue *q, struct StageStats *stats)
+{
+    unsigned long head;
+    double started;
+    void *value;
+
+    head = q->head;
+
+    if (__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == head)
+    {
+        started = now_seconds();
+
+        while (__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == head)
+        {
+            sched_yield();
+        }
+
+        stats->stalled += now_seconds() - started;
+    }
+
+    value = q->slots[head & q->mask];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+    return value;
+}
+
+
+/**
+ * @function read_full
+ *
+ * @brief Read from a file descriptor until the buffer is full or the file ends
+ *
+ * @return number of bytes read, -1 on a read error
+ */
+static long read_full(int fd, char *buffer, long size)
+{
+    long total;
+    long n;
+
+    total = 0;
+
+    while (total < size)
+    {
+        n = read(fd, buffer + total, size - total);
+
+        if (n < 0)
+        {
+            perror("read");
+            return -1;
+        }
+
+        if (n == 0)
+        {
+            break;
+        }
+
+        total += n;
+    }
+
+    return total;
+}
+
+
+/**
+ * @function read_chunks
+ *
+ * @brief Reader stage of the loader
+ *
+ * @discussion
+ * <p>This function reads the text in LOADER_CHUNK_SIZE blocks and cuts every block after its last
+ * new line character. The remaining part is carried to the next chunk. The kernel is asked to read
+ * ahead of the current position, so the disk works while other stages parse. Compressed files are
+ * decompressed here, so decompression overlaps tokenizing and building too. Chunks are dealt to
+ * tokenizer workers in turn, and every worker gets NULL at the end.
+ *
+ * @param arg is the struct Pipeline instance
+ * @return NULL
+ */
+void *read_chunks(void *arg)
+{
+    struct Pipeline *p;
+    struct Chunk *chunk;
+    char *carry;
+    char *data;
+    long carry_size;
+    long sequence;
+    long size;
+    long n;
+    long k;
+    int i;
+    double started;
+
+    p = arg;
+    started = now_seconds();
+    carry = malloc(LOADER_CHUNK_SIZE);
+    carry_size = 0;
+    sequence = 0;
+
+    posix_fadvise(p->input->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    for (;;)
+    {
+        posix_fadvise(p->input->fd, p->input->bytes_read, LOADER_READAHEAD, POSIX_FADV_WILLNEED);
+
+        data = malloc(carry_size + LOADER_CHUNK_SIZE + 1);
+
+        if (data == NULL)
+        {
+            fprintf(stderr, "Chunk allocation error\n");
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(data, carry, carry_size);
+        n = read_input(p->input, data + carry_size, LOADER_CHUNK_SIZE);
+
+        if (n < 0)
+        {
+            /* load_file sees the error of the stream */
+            free(data);
+            break;
+        }
+
+        p->reader.bytes += n;
+        size = carry_size + n;
+
+        if (size == 0)
+        {
+            free(data);
+            break;
+        }
+
+        /* Cut after the last line end, the last line of the file may not have one */
+        k = size;
+        if (n > 0)
+        {
+            while (k > 0 && data[k - 1] != '\n')
+            {
+                k--;
+            }
+        }
+
+        if (k == 0)
+        {
+            /* A line longer than the chunk, keep reading it */
+            carry = realloc(carry, size);
+            memcpy(carry, data, size);
+            carry_size = size;
+            free(data);
+            continue;
+        }
+
+        carry_size = size - k;
+        memcpy(carry, data + k, carry_size);
+        data[k] = '\0';
+
+        chunk = calloc(1, sizeof(struct Chunk));
+        chunk->data = data;
+        chunk->size = k;
+
+        ring_push(&p->workers[sequence % p->worker_count].input, chunk, &p->reader);
+        sequence++;
+        p->reader.items++;
+
+        if (n == 0)
+        {
+            break;
+        }
+    }
+
+    for (i = 0; i < p->worker_count; i++)
+    {
+        ring_push(&p->workers[i].input, NULL, &p->reader);
+    }
+
+    free(carry);
+    p->reader.busy = now_seconds() - started - p->reader.stalled;
+
+    return NULL;
+}
+
+
+/**
+ * @function scan_delimiters_scalar
+ *
+ * @brief Find delimiters of a block one byte at a time
+ *
+ * @discussion
+ * <p>The offset is always written and kept only for a delimiter, so the loop has no branch on the
+ * data.
+ */
+static long scan_delimiters_scalar(const char *data, long size, uint32_t *offsets)
+{
+    long i;
+    long n;
+
+    n = 0;
+    for (i = 0; i < size; i++)
+    {
+        offsets[n] = (uint32_t) i;
+        n += (data[i] == '/') | (data[i] == '\n');
+    }
+
+    return n;
+}
+
+
+#ifdef X86_SIMD
+/**
+ * @function scan_delimiters_sse2
+ *
+ * @brief Find delimiters of a block 16 bytes at a time
+ *
+ * @discussion
+ * <p>Bytes are compared with '/' and '\n' in one vector, and the comparison is turned into a bit
+ * mask. Delimiters are rare, so the loop mostly loads, compares and moves on.
+ */
+__attribute__((target("sse2")))
+static long scan_delimiters_sse2(const char *data, long size, uint32_t *offsets)
+{
+    __m128i slash;
+    __m128i newline;
+    __m128i v;
+    unsigned int mask;
+    long i;
+    long n;
+
+    slash = _mm_set1_epi8('/');
+    newline = _mm_set1_epi8('\n');
+    n = 0;
+
+    for (i = 0; i + 16 <= size; i += 16)
+    {
+        v = _mm_loadu_si128((const __m128i *) (data + i));
+        mask = (unsigned int) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, slash),
+                                                             _mm_cmpeq_epi8(v, newline)));
+
+        while (mask != 0)
+        {
+            offsets[n++] = (uint32_t) (i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < size; i++)
+    {
+        offsets[n] = (uint32_t) i;
+        n += (data[i] == '/') | (data[i] == '\n');
+    }
+
+    return n;
+}
+
+
+/**
+ * @function scan_delimiters_avx2
+ *
+ * @brief Find delimiters of a block 64 bytes at a time
+ *
+ * @discussion
+ * <p>Two 32 byte vectors make a 64 bit mask, so a mask covers a whole cache line.
+ */
+__attribute__((target("avx2")))
+static long scan_delimiters_avx2(const char *data, long size, uint32_t *offsets)
+{
+    __m256i slash;
+    __m256i newline;
+    __m256i lo;
+    __m256i hi;
+    uint64_t mask;
+    long i;
+    long n;
+
+    slash = _mm256_set1_epi8('/');
+    newline = _mm256_set1_epi8('\n');
+    n = 0;
+
+    for (i = 0; i + 64 <= size; i += 64)
+    {
+        lo = _mm256_loadu_si256((const __m256i *) (data + i));
+        hi = _mm256_loadu_si256((const __m256i *) (data + i + 32));
+        lo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, slash), _mm256_cmpeq_epi8(lo, newline));
+        hi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, slash), _mm256_cmpeq_epi8(hi, newline));
+        mask = (uint32_t) _mm256_movemask_epi8(lo) | ((uint64_t) (uint32_t) _mm256_movemask_epi8(hi) << 32);
+
+        while (mask != 0)
+        {
+            offsets[n++] = (uint32_t) (i + __builtin_ctzll(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < size; i++)
+    {
+        offsets[n] = (uint32_t) i;
+        n += (data[i] == '/') | (data[i] == '\n');
+    }
+
+    return n;
+}
+#endif
+
+
+/**
+ * @function delimiter_scanners
+ *
+ * @brief List the delimiter scanners this CPU supports
+ *
+ * @param scanners is the array to fill, it must have room for MAX_DELIMITER_SCANNERS entries
+ * @return number of scanners, the scalar one is first and the fastest one is last
+ */
+int delimiter_scanners(struct DelimiterScanner *scanners)
+{
+    int n;
+
+    n = 0;
+    scanners[n].name = "scalar";
+    scanners[n++].scan = scan_delimiters_scalar;
+
+#ifdef X86_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        scanners[n].name = "sse2";
+        scanners[n++].scan = scan_delimiters_sse2;
+    }
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scanners[n].name = "avx2";
+        scanners[n++].scan = scan_delimiters_avx2;
+    }
+#endif
+
+    return n;
+}
+
+
+/**
+ * @function cut_token
+ *
+ * @brief Record the token before a delimiter of a chunk
+ *
+ * @param chunk is the chunk being tokenized
+ * @param start is the offset of the token
+ * @param end is the offset of the delimiter
+ * @param line_end is 1 if the delimiter ends a line
+ * @param capacity is the size of the tokens array
+ * @param line_start is the number of tokens before the current line
+ */
+static void cut_token(struct Chunk *chunk, long start, long end, int line_end, long *capacity,
+                      long *line_start)
+{
+    if (end > start)
+    {
+        /* Room for the token and the NULL of the line */
+        if (chunk->token_count + 2 > *capacity)
+        {
+            *capacity *= 2;
+            chunk->tokens = realloc(chunk->tokens, *capacity * sizeof(char*));
+
+            if (chunk->tokens == NULL)
+            {
+                fprintf(stderr, "Token allocation error\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        chunk->tokens[chunk->token_count++] = chunk->data + start;
+        chunk->data[end] = '\0';
+    }
+
+    if (line_end)
+    {
+        if (chunk->token_count > *line_start)
+        {
+            chunk->tokens[chunk->token_count++] = NULL;
+            chunk->record_count++;
+        }
+
+        *line_start = chunk->token_count;
+    }
+}
+
+
+/**
+ * @function tokenize_chunk
+ *
+ * @brief Split lines of a chunk into tokens
+ *
+ * @discussion
+ * <p>The scanner finds delimiters of a block at once, then tokens are cut in place between them like
+ * strtok does, so the result is the same as parse_line on every line: empty tokens are skipped, and
+ * lines without tokens are not recorded. Nothing is copied, tokens point into the chunk data.
+ *
+ * @param chunk is the chunk to tokenize
+ * @param scanner is the delimiter scanner to use
+ */
+void tokenize_chunk(struct Chunk *chunk, struct DelimiterScanner *scanner)
+{
+    uint32_t *offsets;
+    long capacity;
+    long line_start;
+    long start;
+    long block;
+    long size;
+    long count;
+    long i;
+    long p;
+
+    capacity = chunk->size / 16 + 16;
+    chunk->tokens = malloc(capacity * sizeof(char*));
+    chunk->token_count = 0;
+    chunk->record_count = 0;
+
+    offsets = malloc(TOKENIZER_BLOCK * sizeof(uint32_t));
+
+    if (chunk->tokens == NULL || offsets == NULL)
+    {
+        fprintf(stderr, "Token allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    start = 0;
+    line_start = 0;
+
+    for (block = 0; block < chunk->size; block += TOKENIZER_BLOCK)
+    {
+        size = chunk->size - block < TOKENIZER_BLOCK ? chunk->size - block : TOKENIZER_BLOCK;
+        count = scanner->scan(chunk->data + block, size, offsets);
+
+        for (i = 0; i < count; i++)
+        {
+            p = block + offsets[i];
+            cut_token(chunk, start, p, chunk->data[p] == '\n', &capacity, &line_start);
+            start = p + 1;
+        }
+    }
+
+    /* The last line may have no line end */
+    cut_token(chunk, start, chunk->size, 1, &capacity, &line_start);
+
+    free(offsets);
+}
+
+
+/**
+ * @function tokenize_chunks
+ *
+ * @brief Tokenizer stage of the loader
+ *
+ * @param arg is the struct TokenizerStage instance
+ * @return NULL
+ */
+void *tokenize_chunks(void *arg)
+{
+    struct TokenizerStage *w;
+    struct Chunk *chunk;
+    double started;
+
+    w = arg;
+    started = now_seconds();
+
+    while ((chunk = ring_pop(&w->input, &w->stats)) != NULL)
+    {
+        tokenize_chunk(chunk, &w->scanner);
+
+        w->stats.items += chunk->record_count;
+        w->stats.bytes += chunk->size;
+
+        ring_push(&w->output, chunk, &w->stats);
+    }
+
+    ring_push(&w->output, NULL, &w->stats);
+    w->stats.busy = now_seconds() - started - w->stats.stalled;
+
+    return NULL;
+}
+
+
+/**
+ * @function load_file
+ *
+ * @brief Read a file and build hash tables with a pipeline
+ *
+ * @discussion
+ * <p>Reading, tokenizing and building overlap: a reader thread, tokenizer workers and the builder
+ * on the calling thread are connected with bounded ring queues. The file may be plain text or gzip
+ * or zstd compressed. The hash table size is estimated from the file size, since lines are not
+ * counted before building.
+ *
+ * @param path is the file path
+ * @param movies is set to the movies hash table
+ * @param actors is set to the actors hash table
+ * @param chunks is set to the list of chunks, they must be freed after the tables
+ * @param stats is set to the statistics of the stages
+ * @return 0 on success, -1 if the file can not be opened or read
+ */
+int load_file(char *path, struct HashTable **movies, struct HashTable **actors, struct Chunk **chunks,
+              struct LoadStats *stats)
+{
+    struct Pipeline *p;
+    struct Chunk *chunk;
+    struct Chunk **last;
+    struct stat st;
+    pthread_t reader;
+    long sequence;
+    long m;
+    long j;
+    long cpus;
+    int i;
+    int scanners;
+    double started;
+    struct DelimiterScanner scanner[MAX_DELIMITER_SCANNERS];
+
+    started = now_seconds();
+    memset(stats, 0, sizeof(struct LoadStats));
+
+    p = calloc(1, sizeof(struct Pipeline));
+    p->input = open_input_stream(path);
+
+    if (p->input == NULL || fstat(p->input->fd, &st) != 0)
+    {
+        if (p->input != NULL)
+        {
+            close_input_stream(p->input);
+        }
+
+        free(p);
+        return -1;
+    }
+
+    m = (long) st.st_size / LOADER_BYTES_PER_BUCKET + 1;
+    if (p->input->format != INPUT_PLAIN)
+    {
+        m *= LOADER_COMPRESSION_RATIO;
+    }
+
+    *movies = create_hash_table((int) m);
+    *actors = create_hash_table((int) m);
+
+    /* One core for the reader, one for the builder, the rest tokenize */
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    p->worker_count = (cpus > 3) ? (int) cpus - 2 : 1;
+    if (p->worker_count > LOADER_MAX_TOKENIZERS)
+    {
+        p->worker_count = LOADER_MAX_TOKENIZERS;
+    }
+
+    /* The last scanner is the fastest */
+    scanners = delimiter_scanners(scanner);
+
+    for (i = 0; i < p->worker_count; i++)
+    {
+        ring_init(&p->workers[i].input);
+        ring_init(&p->workers[i].output);
+        p->workers[i].scanner = scanner[scanners - 1];
+        pthread_create(&p->workers[i].thread, NULL, tokenize_chunks, &p->workers[i]);
+    }
+
+    pthread_create(&reader, NULL, read_chunks, p);
+
+    /* Builder stage */
+    *chunks = NULL;
+    last = chunks;
+    sequence = 0;
+
+    while ((chunk = ring_pop(&p->workers[sequence % p->worker_count].output, &stats->builder)) != NULL)
+    {
+        j = 0;
+        while (j < chunk->token_count)
+        {
+            add_movie(chunk->tokens + j, *movies, *actors);
+
+            while (chunk->tokens[j] != NULL)
+            {
+                j++;
+            }
+            j++;
+        }
+
+        stats->builder.items += chunk->record_count;
+        stats->builder.bytes += chunk->size;
+
+        free(chunk->tokens);
+        chunk->tokens = NULL;
+
+        *last = chunk;
+        last = &chunk->next;
+        sequence++;
+    }
+
+    pthread_join(reader, NULL);
+
+    for (i = 0; i < p->worker_count; i++)
+    {
+        pthread_join(p->workers[i].thread, NULL);
+
+        stats->tokenizer.items += p->workers[i].stats.items;
+        stats->tokenizer.bytes += p->workers[i].stats.bytes;
+        stats->tokenizer.busy += p->workers[i].stats.busy;
+        stats->tokenizer.stalled += p->workers[i].stats.stalled;
+    }
+
+    if (p->input->error)
+    {
+        /* Names point into the chunks, free them after the tables */
+        free_hash_tables(*movies, *actors);
+        free_chunks(*chunks);
+        *chunks = NULL;
+        close_input_stream(p->input);
+        free(p);
+        return -1;
+    }
+
+    stats->format = p->input->format;
+    stats->file_bytes = p->input->bytes_read;
+    close_input_stream(p->input);
+
+    stats->reader = p->reader;
+    stats->tokenizer_count = p->worker_count;
+    stats->elapsed = now_seconds() - started;
+    stats->builder.busy = stats->elapsed - stats->builder.stalled;
+
+    free(p);
+
+    return 0;
+}
+
+
+/**
+ * @function free_chunks
+ *
+ * @brief Free a list of chunks
+ *
+ * @param chunks is the first chunk of the list
+ */
+void free_chunks(struct Chunk *chunks)
+{
+    struct Chunk *next;
+
+    while (chunks != NULL)
+    {
+        next = chunks->next;
+        free(chunks->tokens);
+        free(chunks->data);
+        free(chunks);
+        chunks = next;
+    }
+}
+
+
+/**
+ * @function print_stage_stats
+ *
+ * @brief Print a line of the loader statistics table
+ */
+static void print_stage_stats(char *name, struct StageStats *stats, int workers)
+{
+    double busy;
+    double stalled;
+
+    busy = stats->busy / workers;
+    stalled = stats->stalled / workers;
+
+    printf("%-14s %10ld %10.1f %10.3f %10.3f %9.1f%%\n", name, stats->items,
+           busy > 0 ? stats->bytes / busy / 1e6 : 0.0, busy, stalled,
+           busy + stalled > 0 ? 100.0 * stalled / (busy + stalled) : 0.0);
+}
+
+
+/**
+ * @function print_load_stats
+ *
+ * @brief Print throughput and stall time of every loader stage
+ *
+ * @discussion
+ * <p>Busy throughput is what a stage could do alone. The stage with the longest busy time per
+ * worker is the one the others wait for, it limits the load.
+ *
+ * @param stats is the statistics of a load
+ */
+void print_load_stats(struct LoadStats *stats)
+{
+    char name[MAX_INPUT];
+    double busy[3];
+    int limiting;
+    int i;
+
+    printf("Loaded %.1f MB in %.3f s (%.1f MB/s)\n", stats->reader.bytes / 1e6, stats->elapsed,
+           stats->elapsed > 0 ? stats->reader.bytes / stats->elapsed / 1e6 : 0.0);
+
+    if (stats->format != INPUT_PLAIN)
+    {
+        printf("Decompressed from %.1f MB of %s input (ratio %.2f)\n", stats->file_bytes / 1e6,
+               stats->format == INPUT_GZIP ? "gzip" : "zstd",
+               stats->file_bytes > 0 ? (double) stats->reader.bytes / stats->file_bytes : 0.0);
+    }
+
+    printf("%-14s %10s %10s %10s %10s %10s\n", "Stage", "Items", "MB/s busy", "Busy s", "Stalled s", "Stalled");
+
+    sprintf(name, "tokenizer x%d", stats->tokenizer_count);
+    print_stage_stats("reader", &stats->reader, 1);
+    print_stage_stats(name, &stats->tokenizer, stats->tokenizer_count);
+    print_stage_stats("builder", &stats->builder, 1);
+
+    busy[0] = stats->reader.busy;
+    busy[1] = stats->tokenizer.busy / stats->tokenizer_count;
+    busy[2] = stats->builder.busy;
+
+    limiting = 0;
+    for (i = 1; i < 3; i++)
+    {
+        if (busy[i] > busy[limiting])
+        {
+            limiting = i;
+        }
+    }
+
+    printf("Limiting stage: %s\n", limiting == 0 ? "reader" : (limiting == 1 ? "tokenizer" : "builder"));
+}
+
+
+/**
+ * @function read_whole_input
+ *
+ * @brief Read a whole plain or compressed file into memory
+ *
+ * @param path is the file path
+ * @param size is set to the number of bytes read
+ * @return NUL terminated text, NULL if the file can not be opened or read
+ */
+static char *read_whole_input(char *path, long *size)
+{
+    struct InputStream *in;
+    char *data;
+    long capacity;
+    long n;
+
+    in = open_input_stream(path);
+    if (in == NULL)
+    {
+        return NULL;
+    }
+
+    capacity = LOADER_CHUNK_SIZE;
+    data = malloc(capacity + 1);
+    *size = 0;
+
+    while ((n = read_input(in, data + *size, capacity - *size)) > 0)
+    {
+        *size += n;
+
+        if (*size == capacity)
+        {
+            capacity *= 2;
+            data = realloc(data, capacity + 1);
+        }
+    }
+
+    close_input_stream(in);
+
+    if (n < 0)
+    {
+        free(data);
+        return NULL;
+    }
+
+    data[*size] = '\0';
+
+    return data;
+}
+
+
+/**
+ * @function same_tokens
+ *
+ * @brief Compare the tokens of two tokenized chunks
+ *
+ * @return index of the first different token, -1 if every token is the same
+ */
+static long same_tokens(struct Chunk *a, struct Chunk *b)
+{
+    long i;
+
+    for (i = 0; i < a->token_count && i < b->token_count; i++)
+    {
+        if ((a->tokens[i] == NULL) != (b->tokens[i] == NULL) ||
+            (a->tokens[i] != NULL && strcmp(a->tokens[i], b->tokens[i]) != 0))
+        {
+            return i;
+        }
+    }
+
+    return a->token_count == b->token_count ? -1 : i;
+}
+
+
+/**
+ * @function benchmark_tokenizer
+ *
+ * @brief Measure delimiter scanners and tokenizers on a file
+ *
+ * @discussion
+ * <p>The reference is parse_line, which is strtok, on every line. Every scanner is measured alone,
+ * then as part of tokenize_chunk, and its tokens are compared with the reference tokens. The whole
+ * file is one chunk, so the numbers are for one core.
+ *
+ * @param path is the file path
+ */
+void benchmark_tokenizer(char *path)
+{
+    struct DelimiterScanner scanner[MAX_DELIMITER_SCANNERS];
+    struct Chunk reference;
+    struct Chunk chunk;
+    uint32_t *offsets;
+    char *data;
+    char *line;
+    char *line_end;
+    char **tokens;
+    long size;
+    long block;
+    long rounds;
+    long capacity;
+    long diff;
+    long j;
+    int scanners;
+    int i;
+    double started;
+    double scan_time;
+    double tokenize_time;
+
+    data = read_whole_input(path, &size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Could not load file: %s\n", path);
+        return;
+    }
+
+    /* Reference: split lines, then strtok every line */
+    memset(&reference, 0, sizeof(struct Chunk));
+    reference.data = malloc(size + 1);
+    memcpy(reference.data, data, size + 1);
+
+    capacity = size / 16 + 16;
+    reference.tokens = malloc(capacity * sizeof(char*));
+
+    started = now_seconds();
+    line = reference.data;
+
+    while (line < reference.data + size)
+    {
+        line_end = memchr(line, '\n', reference.data + size - line);
+        if (line_end == NULL)
+        {
+            line_end = reference.data + size;
+        }
+
+        *line_end = '\0';
+        tokens = parse_line(line);
+
+        for (j = 0; tokens[j] != NULL; j++)
+        {
+            if (reference.token_count + 2 > capacity)
+            {
+                capacity *= 2;
+                reference.tokens = realloc(reference.tokens, capacity * sizeof(char*));
+            }
+
+            reference.tokens[reference.token_count++] = tokens[j];
+        }
+
+        if (j > 0)
+        {
+            reference.tokens[reference.token_count++] = NULL;
+            reference.record_count++;
+        }
+
+        free(tokens);
+        line = line_end + 1;
+    }
+
+    tokenize_time = now_seconds() - started;
+
+    printf("Tokenizer benchmark on %.1f MB, %ld records, %ld tokens\n", size / 1e6, reference.record_count,
+           reference.token_count - reference.record_count);
+    printf("%-10s %12s %14s %10s\n", "Scanner", "Scan GB/s", "Tokenize GB/s", "Output");
+    printf("%-10s %12s %14.2f %10s\n", "strtok", "-", tokenize_time > 0 ? size / tokenize_time / 1e9 : 0.0,
+           "reference");
+
+    scanners = delimiter_scanners(scanner);
+    offsets = malloc(TOKENIZER_BLOCK * sizeof(uint32_t));
+
+    for (i = 0; i < scanners; i++)
+    {
+        /* Scanner alone, repeated until the time is long enough to measure */
+        rounds = 0;
+        started = now_seconds();
+
+        do
+        {
+            for (block = 0; block < size; block += TOKENIZER_BLOCK)
+            {
+                scanner[i].scan(data + block, size - block < TOKENIZER_BLOCK ? size - block : TOKENIZER_BLOCK,
+                                offsets);
+            }
+
+            rounds++;
+            scan_time = now_seconds() - started;
+        } while (scan_time < TOKENIZER_BENCH_SECONDS);
+
+        /* Tokenizer with the scanner, on a fresh copy since tokens are cut in place */
+        memset(&chunk, 0, sizeof(struct Chunk));
+        chunk.data = malloc(size + 1);
+        chunk.size = size;
+        memcpy(chunk.data, data, size + 1);
+
+        started = now_seconds();
+        tokenize_chunk(&chunk, &scanner[i]);
+        tokenize_time = now_seconds() - started;
+
+        diff = same_tokens(&reference, &chunk);
+
+        printf("%-10s %12.2f %14.2f %10s\n", scanner[i].name,
+               scan_time > 0 ? (double) size * rounds / scan_time / 1e9 : 0.0,
+               tokenize_time > 0 ? size / tokenize_time / 1e9 : 0.0, diff == -1 ? "identical" : "DIFFERENT");
+
+        if (diff != -1)
+        {
+            printf("First different token: %ld (%s, expected %s)\n", diff,
+                   diff < chunk.token_count && chunk.tokens[diff] != NULL ? chunk.tokens[diff] : "(end of line)",
+                   diff < reference.token_count && reference.tokens[diff] != NULL ? reference.tokens[diff]
+                                                                                 : "(end of line)");
+        }
+
+        free(chunk.tokens);
+        free(chunk.data);
+    }
+
+    free(offsets);
+    free(reference.tokens);
+    free(reference.data);
+    free(data);
+}
+
+
+/**
+ * @function fill_input
+ *
+ * @brief Read the next block of an input stream's file
+ *
+ * @param in is the input stream
+ * @return number of bytes read, 0 at the end of the file, -1 on a read error
+ */
+static long fill_input(struct InputStream *in)
+{
+    long n;
+
+    n = read_full(in->fd, (char *) in->input, LOADER_CHUNK_SIZE);
+    in->input_pos = 0;
+
+    if (n < 0)
+    {
+        in->error = 1;
+        in->input_size = 0;
+        return -1;
+    }
+
+    in->input_size = n;
+    in->bytes_read += n;
+
+    return n;
+}
+
+
+/**
+ * @function open_input_stream
+ *
+ * @brief Open a plain or compressed input file
+ *
+ * @discussion
+ * <p>The first bytes of the file are checked for gzip and zstd magic numbers. They are kept in the
+ * input buffer and read again as the beginning of the stream.
+ *
+ * @param path is the file path
+ * @return pointer to InputStream instance, NULL if the file can not be opened or its format is not
+ * supported
+ */
+struct InputStream *open_input_stream(char *path)
+{
+    struct InputStream *in;
+    unsigned char *b;
+
+    in = calloc(1, sizeof(struct InputStream));
+    in->fd = open(path, O_RDONLY);
+    in->input = malloc(LOADER_CHUNK_SIZE);
+
+    if (in->fd < 0 || in->input == NULL)
+    {
+        if (in->fd >= 0)
+        {
+            close(in->fd);
+        }
+
+        free(in->input);
+        free(in);
+        return NULL;
+    }
+
+    if (fill_input(in) < 0)
+    {
+        close_input_stream(in);
+        return NULL;
+    }
+
+    b = in->input;
+
+    if (in->input_size >= 2 && b[0] == 0x1F && b[1] == 0x8B)
+    {
+        in->format = INPUT_GZIP;
+    }
+    else if (in->input_size >= 4 && b[0] == 0x28 && b[1] == 0xB5 && b[2] == 0x2F && b[3] == 0xFD)
+    {
+        in->format = INPUT_ZSTD;
+    }
+    else
+    {
+        in->format = INPUT_PLAIN;
+    }
+
+#ifdef HAVE_ZLIB
+    if (in->format == INPUT_GZIP)
+    {
+        /* 15 + 16: gzip header, largest window */
+        if (inflateInit2(&in->gz, 15 + 16) != Z_OK)
+        {
+            fprintf(stderr, "Could not initialize gzip decompression\n");
+            close_input_stream(in);
+            return NULL;
+        }
+
+        in->gz.next_in = in->input;
+        in->gz.avail_in = (uInt) in->input_size;
+    }
+#else
+    if (in->format == INPUT_GZIP)
+    {
+        fprintf(stderr, "%s is gzip compressed, but the program is built without zlib\n", path);
+        close_input_stream(in);
+        return NULL;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    if (in->format == INPUT_ZSTD)
+    {
+        in->zs = ZSTD_createDStream();
+
+        if (in->zs == NULL || ZSTD_isError(ZSTD_initDStream(in->zs)))
+        {
+            fprintf(stderr, "Could not initialize zstd decompression\n");
+            close_input_stream(in);
+            return NULL;
+        }
+    }
+#else
+    if (in->format == INPUT_ZSTD)
+    {
+        fprintf(stderr, "%s is zstd compressed, but the program is built without zstd\n", path);
+        close_input_stream(in);
+        return NULL;
+    }
+#endif
+
+    return in;
+}
+
+
+#ifdef HAVE_ZLIB
+/**
+ * @function read_gzip
+ *
+ * @brief Decompress gzip text into a buffer
+ *
+ * @discussion
+ * <p>Files made of several gzip members, like concatenated .gz files, are read to the end. Corrupt
+ * data and a file that ends inside a member set the error field of the stream.
+ *
+ * @return number of bytes written, less than size only at the end of the stream or on an error
+ */
+static long read_gzip(struct InputStream *in, char *buffer, long size)
+{
+    long n;
+    int ret;
+
+    in->gz.next_out = (Bytef *) buffer;
+    in->gz.avail_out = (uInt) size;
+
+    while (in->gz.avail_out > 0)
+    {
+        if (in->gz.avail_in == 0)
+        {
+            n = fill_input(in);
+
+            if (n == 0 && in->in_frame)
+            {
+                fprintf(stderr, "gzip error: unexpected end of file\n");
+                in->error = 1;
+            }
+
+            if (n <= 0)
+            {
+                break;
+            }
+
+            in->gz.next_in = in->input;
+            in->gz.avail_in = (uInt) in->input_size;
+        }
+
+        ret = inflate(&in->gz, Z_NO_FLUSH);
+        in->in_frame = 1;
+
+        if (ret == Z_STREAM_END)
+        {
+            inflateReset(&in->gz);
+            in->in_frame = 0;
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            fprintf(stderr, "gzip error: %s\n", in->gz.msg != NULL ? in->gz.msg : "corrupt input");
+            in->error = 1;
+            break;
+        }
+    }
+
+    return size - (long) in->gz.avail_out;
+}
+#endif
+
+
+#ifdef HAVE_ZSTD
+/**
+ * @function read_zstd
+ *
+ * @brief Decompress zstd text into a buffer
+ *
+ * @discussion
+ * <p>Files made of several zstd frames are read to the end. Corrupt data and a file that ends
+ * inside a frame set the error field of the stream.
+ *
+ * @return number of bytes written, less than size only at the end of the stream or on an error
+ */
+static long read_zstd(struct InputStream *in, char *buffer, long size)
+{
+    ZSTD_outBuffer out;
+    ZSTD_inBuffer zin;
+    size_t ret;
+    long n;
+
+    out.dst = buffer;
+    out.size = (size_t) size;
+    out.pos = 0;
+
+    while (out.pos < out.size)
+    {
+        if (in->input_pos == in->input_size)
+        {
+            n = fill_input(in);
+
+            if (n == 0 && in->in_frame)
+            {
+                fprintf(stderr, "zstd error: unexpected end of file\n");
+                in->error = 1;
+            }
+
+            if (n <= 0)
+            {
+                break;
+            }
+        }
+
+        zin.src = in->input;
+        zin.size = (size_t) in->input_size;
+        zin.pos = (size_t) in->input_pos;
+
+        ret = ZSTD_decompressStream(in->zs, &out, &zin);
+        in->input_pos = (long) zin.pos;
+
+        if (ZSTD_isError(ret))
+        {
+            fprintf(stderr, "zstd error: %s\n", ZSTD_getErrorName(ret));
+            in->error = 1;
+            break;
+        }
+
+        /* 0 once a frame is decoded and flushed */
+        in->in_frame = ret != 0;
+    }
+
+    return (long) out.pos;
+}
+#endif
+
+
+/**
+ * @function read_input
+ *
+ * @brief Read text from an input stream
+ *
+ * @param in is the input stream
+ * @param buffer is the buffer to write text
+ * @param size is the size of the buffer
+ * @return number of bytes read, less than size only at the end of the stream, -1 if the file can not
+ * be read
+ */
+long read_input(struct InputStream *in, char *buffer, long size)
+{
+    long n;
+    long count;
+
+    if (in->error)
+    {
+        return -1;
+    }
+
+#ifdef HAVE_ZLIB
+    if (in->format == INPUT_GZIP)
+    {
+        n = read_gzip(in, buffer, size);
+        return in->error ? -1 : n;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    if (in->format == INPUT_ZSTD)
+    {
+        n = read_zstd(in, buffer, size);
+        return in->error ? -1 : n;
+    }
+#endif
+
+    /* Plain text: bytes read while detecting the format come first */
+    n = in->input_size - in->input_pos;
+    if (n > size)
+    {
+        n = size;
+    }
+
+    memcpy(buffer, in->input + in->input_pos, n);
+    in->input_pos += n;
+
+    if (n < size)
+    {
+        count = read_full(in->fd, buffer + n, size - n);
+
+        if (count < 0)
+        {
+            in->error = 1;
+            return -1;
+        }
+
+        in->bytes_read += count;
+        n += count;
+    }
+
+    return n;
+}
+
+
+/**
+ * @function close_input_stream
+ *
+ * @brief Close an input stream and free its buffers
+ *
+ * @param in is the input stream
+ */
+void close_input_stream(struct InputStream *in)
+{
+#ifdef HAVE_ZLIB
+    if (in->format == INPUT_GZIP)
+    {
+        inflateEnd(&in->gz);
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    if (in->format == INPUT_ZSTD && in->zs != NULL)
+    {
+        ZSTD_freeDStream(in->zs);
+    }
+#endif
+
+    close(in->fd);
+    free(in->input);
+    free(in);
+}
+
+
+/**
+ * @function write_section
+ *
+ * @brief Write the records of an adjacency file section cut into blocks
+ *
+ * @discussion
+ * <p>Rows are written when names is NULL, names otherwise. A block is closed before a record that
+ * would make it larger than block_bytes, so a block is larger only when it has a single record.
+ *
+ * @return 0 on success, -1 on a write error
+ */
+static int write_section(FILE *f, struct AdjacencyHeader *h, int section, struct AdjacencyBlock **blocks,
+                         long n, int *offsets, int *ids, char **names, long block_bytes)
+{
+    struct AdjacencyBlock *b;
+    uint32_t length;
+    uint32_t id;
+    int64_t size;
+    long capacity;
+    long i;
+    int j;
+
+    capacity = 16;
+    *blocks = malloc(capacity * sizeof(struct AdjacencyBlock));
+    h->block_count[section] = 0;
+    h->section_bytes[section] = 0;
+    b = NULL;
+
+    for (i = 0; i < n; i++)
+    {
+        if (names == NULL)
+        {
+            size = (int64_t) sizeof(uint32_t) * (1 + offsets[i + 1] - offsets[i]);
+        }
+        else
+        {
+            size = (int64_t) strlen(names[i]) + 1;
+        }
+
+        if (b == NULL || (b->size > 0 && b->size + size > block_bytes))
+        {
+            if (h->block_count[section] == capacity)
+            {
+                capacity *= 2;
+                *blocks = realloc(*blocks, capacity * sizeof(struct AdjacencyBlock));
+            }
+
+            b = &(*blocks)[h->block_count[section]++];
+            b->offset = h->section_offset[section] + h->section_bytes[section];
+            b->size = 0;
+            b->first = (int32_t) i;
+            b->count = 0;
+        }
+
+        if (names == NULL)
+        {
+            length = (uint32_t) (offsets[i + 1] - offsets[i]);
+            fwrite(&length, sizeof(uint32_t), 1, f);
+
+            for (j = offsets[i]; j < offsets[i + 1]; j++)
+            {
+                id = (uint32_t) ids[j];
+                fwrite(&id, sizeof(uint32_t), 1, f);
+            }
+        }
+        else
+        {
+            fwrite(names[i], 1, (size_t) size, f);
+        }
+
+        b->size += size;
+        b->count++;
+        h->section_bytes[section] += size;
+
+        if (b->size > h->max_block)
+        {
+            h->max_block = b->size;
+        }
+    }
+
+    return ferror(f) ? -1 : 0;
+}
+
+
+/**
+ * @function write_adjacency_file
+ *
+ * @brief Write a graph to an adjacency file for out of core queries
+ *
+ * @param g is the graph
+ * @param path is the file path
+ * @param block_bytes is the size to cut blocks at
+ * @return 0 on success, -1 if the file can not be written
+ */
+int write_adjacency_file(struct Graph *g, char *path, long block_bytes)
+{
+    struct AdjacencyHeader h;
+    struct AdjacencyBlock *blocks[ADJACENCY_SECTIONS];
+    FILE *f;
+    int result;
+    int i;
+
+    f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+
+    setvbuf(f, NULL, _IOFBF, LOADER_CHUNK_SIZE);
+
+    memset(&h, 0, sizeof(struct AdjacencyHeader));
+    memcpy(h.magic, ADJACENCY_MAGIC, sizeof(h.magic));
+    h.version = ADJACENCY_VERSION;
+    h.block_bytes = (uint32_t) block_bytes;
+    h.actor_count = g->actor_count;
+    h.movie_count = g->movie_count;
+
+    /* The header is written again when the offsets are known */
+    fwrite(&h, sizeof(struct AdjacencyHeader), 1, f);
+
+    h.section_offset[ADJACENCY_ACTORS] = sizeof(struct AdjacencyHeader);
+    result = write_section(f, &h, ADJACENCY_ACTORS, &blocks[ADJACENCY_ACTORS], g->actor_count,
+                           g->actor_offsets, g->actor_movies, NULL, block_bytes);
+
+    h.section_offset[ADJACENCY_MOVIES] = h.section_offset[ADJACENCY_ACTORS] + h.section_bytes[ADJACENCY_ACTORS];
+    result |= write_section(f, &h, ADJACENCY_MOVIES, &blocks[ADJACENCY_MOVIES], g->movie_count,
+                            g->movie_offsets, g->movie_actors, NULL, block_bytes);
+
+    h.section_offset[ADJACENCY_NAMES] = h.section_offset[ADJACENCY_MOVIES] + h.section_bytes[ADJACENCY_MOVIES];
+    result |= write_section(f, &h, ADJACENCY_NAMES, &blocks[ADJACENCY_NAMES], g->actor_count,
+                            NULL, NULL, g->actor_names, block_bytes);
+
+    h.index_offset[0] = h.section_offset[ADJACENCY_NAMES] + h.section_bytes[ADJACENCY_NAMES];
+    for (i = 0; i < ADJACENCY_SECTIONS; i++)
+    {
+        if (i > 0)
+        {
+            h.index_offset[i] = h.index_offset[i - 1] + h.block_count[i - 1] * (int64_t) sizeof(struct AdjacencyBlock);
+        }
+
+        fwrite(blocks[i], sizeof(struct AdjacencyBlock), (size_t) h.block_count[i], f);
+        free(blocks[i]);
+    }
+
+    if (fseek(f, 0, SEEK_SET) != 0)
+    {
+        result = -1;
+    }
+
+    fwrite(&h, sizeof(struct AdjacencyHeader), 1, f);
+
+    if (ferror(f))
+    {
+        result = -1;
+    }
+
+    if (fclose(f) != 0)
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+
+/**
+ * @function read_at
+ *
+ * @brief Read bytes at an offset of a file
+ *
+ * @return 0 if every byte is read, -1 otherwise
+ */
+static int read_at(int fd, char *buffer, long size, int64_t offset)
+{
+    if (lseek(fd, (off_t) offset, SEEK_SET) == (off_t) -1)
+    {
+        return -1;
+    }
+
+    return read_full(fd, buffer, size) == size ? 0 : -1;
+}
+
+
+/**
+ * @function valid_adjacency_header
+ *
+ * @brief Check that the counts and sections of an adjacency file header fit the file
+ *
+ * @return 1 if the header is consistent, 0 otherwise
+ */
+static int valid_adjacency_header(struct AdjacencyHeader *h, int64_t file_size)
+{
+    int i;
+
+    /* Ids are stored as uint32_t and used as int */
+    if (h->actor_count < 0 || h->actor_count > INT32_MAX || h->movie_count < 0 || h->movie_count > INT32_MAX ||
+        h->max_block < 0 || h->max_block > file_size)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < ADJACENCY_SECTIONS; i++)
+    {
+        if (h->section_offset[i] < (int64_t) sizeof(struct AdjacencyHeader) || h->section_bytes[i] < 0 ||
+            h->section_bytes[i] > file_size - h->section_offset[i] || h->block_count[i] < 0 ||
+            h->index_offset[i] < 0 || h->index_offset[i] > file_size ||
+            h->block_count[i] > (file_size - h->index_offset[i]) / (int64_t) sizeof(struct AdjacencyBlock))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @function valid_block_index
+ *
+ * @brief Check that the blocks of a section cover its records in order and lie in the section
+ *
+ * @return 1 if the block index is consistent, 0 otherwise
+ */
+static int valid_block_index(struct AdjacencyHeader *h, int section, struct AdjacencyBlock *blocks)
+{
+    int64_t records;
+    int64_t next;
+    int64_t i;
+
+    records = (section == ADJACENCY_MOVIES) ? h->movie_count : h->actor_count;
+    next = 0;
+
+    for (i = 0; i < h->block_count[section]; i++)
+    {
+        if (blocks[i].first != next || blocks[i].count <= 0 || blocks[i].size < 0 ||
+            blocks[i].size > h->max_block || blocks[i].offset < h->section_offset[section] ||
+            blocks[i].offset - h->section_offset[section] > h->section_bytes[section] - blocks[i].size)
+        {
+            return 0;
+        }
+
+        next += blocks[i].count;
+    }
+
+    return next == records;
+}
+
+
+/**
+ * @function valid_block
+ *
+ * @brief Check that the records of a block read into the buffer fill the block
+ *
+ * @discussion
+ * <p>Row lengths, ids and name ends come from the file and are used as offsets, so every row must
+ * end inside the block with ids of the other section, and every name must end inside the block.
+ *
+ * @return 1 if the block is consistent, 0 otherwise
+ */
+static int valid_block(struct ExternalGraph *eg, int section, struct AdjacencyBlock *b)
+{
+    uint32_t *row;
+    uint32_t *end;
+    uint32_t limit;
+    uint32_t j;
+    char *p;
+    char *last;
+    int k;
+
+    if (section == ADJACENCY_NAMES)
+    {
+        p = eg->buffer;
+        last = eg->buffer + b->size;
+
+        for (k = 0; k < b->count; k++)
+        {
+            p = memchr(p, '\0', last - p);
+            if (p == NULL)
+            {
+                return 0;
+            }
+            p++;
+        }
+
+        return p == last;
+    }
+
+    if (b->size % sizeof(uint32_t) != 0)
+    {
+        return 0;
+    }
+
+    /* Actor rows hold movie ids, movie rows hold actor ids */
+    limit = (uint32_t) ((section == ADJACENCY_ACTORS) ? eg->header.movie_count : eg->header.actor_count);
+    row = (uint32_t *) eg->buffer;
+    end = row + b->size / sizeof(uint32_t);
+
+    for (k = 0; k < b->count; k++)
+    {
+        if (row == end || *row > (uint32_t) (end - row - 1))
+        {
+            return 0;
+        }
+
+        for (j = 1; j <= *row; j++)
+        {
+            if (row[j] >= limit)
+            {
+                return 0;
+            }
+        }
+
+        row += 1 + *row;
+    }
+
+    return row == end;
+}
+
+
+/**
+ * @function open_external_graph
+ *
+ * @brief Open an adjacency file for out of core queries
+ *
+ * @discussion
+ * <p>Counts, offsets and sizes of the header and of the block indexes are used to allocate and to
+ * seek, so a file whose header or block indexes do not fit its size is rejected as corrupt.
+ *
+ * @param path is the file path
+ * @param corrupt is set when the file is an adjacency file that is truncated or not consistent
+ * @return pointer to ExternalGraph instance, NULL if the file can not be opened, is not an
+ * adjacency file or is corrupt
+ */
+struct ExternalGraph *open_external_graph(char *path, int *corrupt)
+{
+    struct ExternalGraph *eg;
+    struct stat st;
+    int i;
+    int ok;
+
+    *corrupt = 0;
+    eg = calloc(1, sizeof(struct ExternalGraph));
+    eg->fd = open(path, O_RDONLY);
+
+    if (eg->fd < 0)
+    {
+        free(eg);
+        return NULL;
+    }
+
+    ok = read_at(eg->fd, (char *) &eg->header, sizeof(struct AdjacencyHeader), 0) == 0 &&
+         memcmp(eg->header.magic, ADJACENCY_MAGIC, sizeof(eg->header.magic)) == 0 &&
+         eg->header.version == ADJACENCY_VERSION;
+
+    if (ok)
+    {
+        *corrupt = fstat(eg->fd, &st) != 0 || !valid_adjacency_header(&eg->header, (int64_t) st.st_size);
+        ok = !*corrupt;
+    }
+
+    for (i = 0; ok && i < ADJACENCY_SECTIONS; i++)
+    {
+        eg->blocks[i] = malloc(eg->header.block_count[i] * sizeof(struct AdjacencyBlock) + 1);
+        ok = read_at(eg->fd, (char *) eg->blocks[i], (long) (eg->header.block_count[i] * sizeof(struct AdjacencyBlock)),
+                     eg->header.index_offset[i]) == 0;
+        *corrupt = !ok || !valid_block_index(&eg->header, i, eg->blocks[i]);
+        ok = !*corrupt;
+    }
+
+    if (ok)
+    {
+        eg->buffer = malloc(eg->header.max_block + 1);
+        ok = eg->buffer != NULL;
+    }
+
+    if (!ok)
+    {
+        close_external_graph(eg);
+        return NULL;
+    }
+
+    posix_fadvise(eg->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return eg;
+}
+
+
+/**
+ * @function close_external_graph
+ *
+ * @brief Close an adjacency file and free its indexes
+ *
+ * @param eg is the external graph
+ */
+void close_external_graph(struct ExternalGraph *eg)
+{
+    int i;
+
+    for (i = 0; i < ADJACENCY_SECTIONS; i++)
+    {
+        free(eg->blocks[i]);
+    }
+
+    close(eg->fd);
+    free(eg->buffer);
+    free(eg);
+}
+
+
+/**
+ * @function read_block
+ *
+ * @brief Read a block of an adjacency file into the buffer
+ *
+ * @return 0 on success, -1 on a read error or a corrupt block
+ */
+static int read_block(struct ExternalGraph *eg, int section, long block)
+{
+    struct AdjacencyBlock *b;
+
+    b = &eg->blocks[section][block];
+
+    if (read_at(eg->fd, eg->buffer, (long) b->size, b->offset) != 0)
+    {
+        fprintf(stderr, "Could not read the adjacency file\n");
+        return -1;
+    }
+
+    if (!valid_block(eg, section, b))
+    {
+        fprintf(stderr, "The adjacency file is corrupt: block %ld of section %d\n", block, section);
+        return -1;
+    }
+
+    eg->blocks_read++;
+    eg->bytes_read += (long) b->size;
+
+    return 0;
+}
+
+
+/**
+ * @function find_block
+ *
+ * @brief Find the block of a section that holds a record
+ *
+ * @return index of the block
+ */
+static long find_block(struct ExternalGraph *eg, int section, int id)
+{
+    struct AdjacencyBlock *blocks;
+    long lo;
+    long hi;
+    long mid;
+
+    blocks = eg->blocks[section];
+    lo = 0;
+    hi = (long) eg->header.block_count[section] - 1;
+
+    /* The last block whose first record is not after id */
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+
+        if (blocks[mid].first <= id)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    return lo;
+}
+
+
+/**
+ * @function external_find_actor
+ *
+ * @brief Find the id of an actor in an adjacency file
+ *
+ * @discussion
+ * <p>Names are not kept in memory, so the names section is scanned once.
+ *
+ * @param eg is the external graph
+ * @param name is the name of the actor
+ * @return id of the actor, -1 if the actor is not in the file
+ */
+int external_find_actor(struct ExternalGraph *eg, char *name)
+{
+    char *p;
+    long b;
+    int i;
+
+    eg->passes++;
+
+    for (b = 0; b < eg->header.block_count[ADJACENCY_NAMES]; b++)
+    {
+        if (read_block(eg, ADJACENCY_NAMES, b) != 0)
+        {
+            return -1;
+        }
+
+        p = eg->buffer;
+
+        for (i = 0; i < eg->blocks[ADJACENCY_NAMES][b].count; i++)
+        {
+            if (strcmp(p, name) == 0)
+            {
+                return eg->blocks[ADJACENCY_NAMES][b].first + i;
+            }
+
+            p += strlen(p) + 1;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @function external_bacon_sweep
+ *
+ * @brief Find the distance of every actor to an actor without loading the graph
+ *
+ * @discussion
+ * <p>This is a semi-external BFS: a distance byte of every actor, two bits of every movie and a flag
+ * of every block are in memory, and the rows are on disk. Every level is two scans, one over the
+ * actor rows to mark the movies of the frontier, and one over the movie rows to reach new actors.
+ * A scan reads only the blocks flagged to hold a frontier record and reads them in file order, so
+ * a sweep reads the file at most twice per level.
+ *
+ * <p>Distances are bytes. Actors farther than UNREACHED - 1 stay unreached, and the saturated field
+ * of the external graph tells that the sweep stopped there.
+ *
+ * @param eg is the external graph
+ * @param start is the id of the starting actor
+ * @param histogram is set to the number of actors at every distance, it must have room for UNREACHED
+ * entries
+ * @return the largest distance, -1 on a read error
+ */
+int external_bacon_sweep(struct ExternalGraph *eg, int start, long *histogram)
+{
+    struct AdjacencyBlock *block;
+    unsigned char *distance;
+    unsigned char *actor_flags;
+    unsigned char *movie_flags;
+    unsigned long *movie_seen;
+    unsigned long *movie_frontier;
+    uint32_t *row;
+    uint32_t length;
+    uint32_t j;
+    long actor_blocks;
+    long movie_blocks;
+    long found;
+    long b;
+    int level;
+    int scanned;
+    int id;
+    int k;
+    int error;
+
+    actor_blocks = (long) eg->header.block_count[ADJACENCY_ACTORS];
+    movie_blocks = (long) eg->header.block_count[ADJACENCY_MOVIES];
+
+    distance = malloc(eg->header.actor_count + 1);
+    actor_flags = calloc(actor_blocks + 1, 1);
+    movie_flags = calloc(movie_blocks + 1, 1);
+    movie_seen = calloc(BITSET_WORDS(eg->header.movie_count) + 1, sizeof(unsigned long));
+    movie_frontier = calloc(BITSET_WORDS(eg->header.movie_count) + 1, sizeof(unsigned long));
+
+    memset(distance, UNREACHED, eg->header.actor_count + 1);
+    memset(histogram, 0, UNREACHED * sizeof(long));
+
+    distance[start] = 0;
+    histogram[0] = 1;
+    actor_flags[find_block(eg, ADJACENCY_ACTORS, start)] = 1;
+
+    level = 0;
+    error = 0;
+    eg->saturated = 0;
+
+    while (!error)
+    {
+        /* Actors of this level mark their unseen movies */
+        found = 0;
+        scanned = 0;
+
+        for (b = 0; b < actor_blocks && !error; b++)
+        {
+            if (!actor_flags[b])
+            {
+                eg->blocks_skipped++;
+                continue;
+            }
+
+            actor_flags[b] = 0;
+            scanned = 1;
+            error = read_block(eg, ADJACENCY_ACTORS, b);
+
+            block = &eg->blocks[ADJACENCY_ACTORS][b];
+            row = (uint32_t *) eg->buffer;
+
+            for (k = 0; k < block->count && !error; k++)
+            {
+                id = block->first + k;
+                length = *row++;
+
+                if (distance[id] == level)
+                {
+                    for (j = 0; j < length; j++)
+                    {
+                        if (!BITSET_TEST(movie_seen, row[j]))
+                        {
+                            BITSET_SET(movie_seen, row[j]);
+                            BITSET_SET(movie_frontier, row[j]);
+                            movie_flags[find_block(eg, ADJACENCY_MOVIES, (int) row[j])] = 1;
+                            found++;
+                        }
+                    }
+                }
+
+                row += length;
+            }
+        }
+
+        eg->passes += scanned;
+
+        if (found == 0 || error)
+        {
+            break;
+        }
+
+        /* Marked movies reach their unreached actors */
+        found = 0;
+        scanned = 0;
+
+        for (b = 0; b < movie_blocks && !error; b++)
+        {
+            if (!movie_flags[b])
+            {
+                eg->blocks_skipped++;
+                continue;
+            }
+
+            movie_flags[b] = 0;
+            scanned = 1;
+            error = read_block(eg, ADJACENCY_MOVIES, b);
+
+            block = &eg->blocks[ADJACENCY_MOVIES][b];
+            row = (uint32_t *) eg->buffer;
+
+            for (k = 0; k < block->count && !error; k++)
+            {
+                id = block->first + k;
+                length = *row++;
+
+                if (BITSET_TEST(movie_frontier, id))
+                {
+                    movie_frontier[id / BITS_PER_WORD] &= ~(1UL << (id % BITS_PER_WORD));
+
+                    for (j = 0; j < length; j++)
+                    {
+                        if (distance[row[j]] == UNREACHED)
+                        {
+                            distance[row[j]] = (unsigned char) (level + 1);
+                            actor_flags[find_block(eg, ADJACENCY_ACTORS, (int) row[j])] = 1;
+                            found++;
+                        }
+                    }
+                }
+
+                row += length;
+            }
+        }
+
+        eg->passes += scanned;
+
+        if (found == 0)
+        {
+            break;
+        }
+
+        /* Actors found at UNREACHED stay unreached, the next level does not fit a byte */
+        if (level + 1 == UNREACHED)
+        {
+            eg->saturated = 1;
+            break;
+        }
+
+        histogram[++level] = found;
+    }
+
+    free(distance);
+    free(actor_flags);
+    free(movie_flags);
+    free(movie_seen);
+    free(movie_frontier);
+
+    return error ? -1 : level;
+}
+
+
+/**
+ * @function print_external_sweep
+ *
+ * @brief Print the result and the disk traffic of an out of core sweep
+ *
+ * @param eg is the external graph
+ * @param histogram is the number of actors at every distance
+ * @param levels is the largest distance
+ * @param elapsed is the time of the sweep, in seconds
+ */
+void print_external_sweep(struct ExternalGraph *eg, long *histogram, int levels, double elapsed)
+{
+    struct stat st;
+    long reached;
+    long state;
+    int i;
+
+    reached = 0;
+    printf("%-10s %12s\n", "Distance", "Actors");
+
+    for (i = 0; i <= levels; i++)
+    {
+        printf("%-10d %12ld\n", i, histogram[i]);
+        reached += histogram[i];
+    }
+
+    printf("%-10s %12ld\n", "Infinite", (long) eg->header.actor_count - reached);
+
+    if (eg->saturated)
+    {
+        printf("Warning: the sweep stopped at distance %d, farther actors are counted as infinite\n", levels);
+    }
+
+    /* Distance bytes, seen and frontier bits, block flags */
+    state = (long) eg->header.actor_count + 2 * (long) (BITSET_WORDS(eg->header.movie_count) * sizeof(unsigned long)) +
+            (long) (eg->header.block_count[ADJACENCY_ACTORS] + eg->header.block_count[ADJACENCY_MOVIES]);
+
+    fstat(eg->fd, &st);
+    printf("Passes: %ld, blocks read: %ld, blocks skipped: %ld\n", eg->passes, eg->blocks_read, eg->blocks_skipped);
+    printf("Read %.1f MB of a %.1f MB file (%.2f times its size) in %.3f s\n", eg->bytes_read / 1e6,
+           st.st_size / 1e6, st.st_size > 0 ? (double) eg->bytes_read / st.st_size : 0.0, elapsed);
+    printf("Memory: %.1f MB node state, %.1f MB block buffer\n", state / 1e6, eg->header.max_block / 1e6);
+}
+
+
+/**
+ * @function detect_topology
+ *
+ * @brief Find the CPUs the process may run on and their NUMA nodes
+ *
+ * @param t is set to the topology, its arrays must be freed
+ */
+void detect_topology(struct Topology *t)
+{
+    cpu_set_t set;
+    int *cpus;
+    int *nodes;
+    int count;
+    int round;
+    int node;
+    int seen;
+    int i;
+
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0)
+    {
+        CPU_SET(0, &set);
+    }
+
+    count = CPU_COUNT(&set);
+    cpus = malloc(count * sizeof(int));
+    nodes = malloc(count * sizeof(int));
+    t->cpus = malloc(count * sizeof(int));
+    t->nodes = malloc(count * sizeof(int));
+    t->cpu_count = count;
+    t->node_count = 1;
+
+    count = 0;
+    for (i = 0; i < CPU_SETSIZE && count < t->cpu_count; i++)
+    {
+        if (CPU_ISSET(i, &set))
+        {
+            cpus[count] = i;
+            nodes[count] = 0;
+
+#ifdef HAVE_NUMA
+            if (numa_available() != -1 && numa_node_of_cpu(i) >= 0)
+            {
+                nodes[count] = numa_node_of_cpu(i);
+            }
+#endif
+
+            if (nodes[count] + 1 > t->node_count)
+            {
+                t->node_count = nodes[count] + 1;
+            }
+
+            count++;
+        }
+    }
+
+    /* Deal CPUs node by node, so n workers are spread over the nodes */
+    count = 0;
+    for (round = 0; count < t->cpu_count; round++)
+    {
+        for (node = 0; node < t->node_count; node++)
+        {
+            seen = 0;
+            for (i = 0; i < t->cpu_count; i++)
+            {
+                if (nodes[i] == node && seen++ == round)
+                {
+                    t->cpus[count] = cpus[i];
+                    t->nodes[count] = node;
+                    count++;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(cpus);
+    free(nodes);
+}
+
+
+/**
+ * @function alloc_placed
+ *
+ * @brief Allocate memory placed on NUMA nodes
+ *
+ * @param size is the size in bytes
+ * @param node is the node to place the memory on, -1 to interleave it over all nodes
+ * @return the memory, NULL if it could not be placed
+ */
+static void *alloc_placed(size_t size, int node)
+{
+#ifdef HAVE_NUMA
+    return (node < 0) ? numa_alloc_interleaved(size) : numa_alloc_onnode(size, node);
+#else
+    (void) size;
+    (void) node;
+
+    return NULL;
+#endif
+}
+
+
+/**
+ * @function place_array
+ *
+ * @brief Copy an array to memory placed on NUMA nodes
+ *
+ * @param src is the array to copy
+ * @param size is the size of the array in bytes
+ * @param node is the node to place the copy on, -1 to interleave it over all nodes
+ * @return the copy, NULL if it could not be placed
+ */
+static void *place_array(void *src, size_t size, int node)
+{
+    void *copy;
+
+    copy = alloc_placed(size, node);
+
+    if (copy != NULL)
+    {
+        memcpy(copy, src, size);
+    }
+
+    return copy;
+}
+
+
+/**
+ * @function free_placed
+ *
+ * @brief Free memory allocated with alloc_placed
+ */
+static void free_placed(void *p, size_t size)
+{
+#ifdef HAVE_NUMA
+    if (p != NULL)
+    {
+        numa_free(p, size);
+    }
+#else
+    (void) p;
+    (void) size;
+#endif
+}
+
+
+/**
+ * @function place_replica
+ *
+ * @brief Copy the adjacency arrays of a graph to a NUMA node
+ *
+ * @discussion
+ * <p>The replica points to the arrays of the graph if a copy can not be placed.
+ *
+ * @param g is the graph
+ * @param r is the replica to fill
+ * @param node is the node to place the copy on, -1 to interleave it over all nodes
+ */
+static void place_replica(struct Graph *g, struct GraphReplica *r, int node)
+{
+    void *src[4];
+    void *copy[4];
+    int i;
+
+    src[0] = g->actor_offsets;
+    src[1] = g->actor_movies;
+    src[2] = g->movie_offsets;
+    src[3] = g->movie_actors;
+
+    r->size[0] = (g->actor_count + 1) * sizeof(int);
+    r->size[1] = g->actor_offsets[g->actor_count] * sizeof(int) + 1;
+    r->size[2] = (g->movie_count + 1) * sizeof(int);
+    r->size[3] = g->movie_offsets[g->movie_count] * sizeof(int) + 1;
+
+    for (i = 0; i < 4; i++)
+    {
+        copy[i] = place_array(src[i], r->size[i], node);
+
+        if (copy[i] == NULL)
+        {
+            while (--i >= 0)
+            {
+                free_placed(copy[i], r->size[i]);
+            }
+
+            memcpy(copy, src, sizeof(src));
+            memset(r->size, 0, sizeof(r->size));
+            break;
+        }
+    }
+
+    r->actor_offsets = copy[0];
+    r->actor_movies = copy[1];
+    r->movie_offsets = copy[2];
+    r->movie_actors = copy[3];
+}
+
+
+/**
+ * @function frontier_push
+ *
+ * @brief Add an actor to a frontier queue
+ */
+static void frontier_push(struct FrontierQueue *q, int actor)
+{
+    if (q->size == q->capacity)
+    {
+        q->capacity = (q->capacity > 0) ? 2 * q->capacity : BFS_QUEUE_SIZE;
+        q->items = realloc(q->items, q->capacity * sizeof(int));
+
+        if (q->items == NULL)
+        {
+            fprintf(stderr, "Frontier allocation error\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    q->items[q->size++] = actor;
+}
+
+
+/**
+ * @function bfs_worker
+ *
+ * @brief Worker thread of the parallel BFS
+ *
+ * @discussion
+ * <p>A worker takes chunks of its own queue first, then of the queues of the other workers, so most
+ * reads of the frontier are local. Actors it finds go to its own queue of the next level. Between
+ * levels the first worker swaps the queues while the others wait at the barrier. Between searches
+ * workers wait at the pool barrier for parallel_bfs, and exit when free_parallel_bfs sets stop.
+ *
+ * @param arg is the struct BfsWorker instance
+ * @return NULL
+ */
+static void *bfs_worker(void *arg)
+{
+    struct BfsWorker *w;
+    struct ParallelBfs *bfs;
+    struct GraphReplica *r;
+    struct FrontierQueue *q;
+    struct FrontierQueue *next;
+    cpu_set_t set;
+    long begin;
+    long end;
+    long total;
+    long k;
+    int expected;
+    int level;
+    int a;
+    int m;
+    int b;
+    int i;
+    int j;
+    int t;
+
+    w = arg;
+    bfs = w->bfs;
+    r = &bfs->replicas[bfs->replica_count > 1 ? w->node : 0];
+
+    if (w->cpu >= 0)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+    }
+
+    for (;;)
+    {
+        pthread_barrier_wait(&bfs->pool);
+
+        if (bfs->stop)
+        {
+            break;
+        }
+
+        while (!bfs->done)
+        {
+            level = bfs->level;
+            next = &w->queues[bfs->current ^ 1];
+
+            for (t = 0; t < bfs->worker_count; t++)
+            {
+                q = &bfs->workers[(w->index + t) % bfs->worker_count].queues[bfs->current];
+
+                while ((begin = __atomic_fetch_add(&q->taken, BFS_STEAL_CHUNK, __ATOMIC_RELAXED)) < q->size)
+                {
+                    end = (begin + BFS_STEAL_CHUNK < q->size) ? begin + BFS_STEAL_CHUNK : q->size;
+
+                    for (k = begin; k < end; k++)
+                    {
+                        a = q->items[k];
+
+                        for (i = r->actor_offsets[a]; i < r->actor_offsets[a + 1]; i++)
+                        {
+                            m = r->actor_movies[i];
+
+                            if (__atomic_load_n(&bfs->movie_seen[m], __ATOMIC_RELAXED) ||
+                                __atomic_exchange_n(&bfs->movie_seen[m], 1, __ATOMIC_RELAXED))
+                            {
+                                continue;
+                            }
+
+                            for (j = r->movie_offsets[m]; j < r->movie_offsets[m + 1]; j++)
+                            {
+                                b = r->movie_actors[j];
+                                expected = -1;
+
+                                if (__atomic_load_n(&bfs->actor_level[b], __ATOMIC_RELAXED) == -1 &&
+                                    __atomic_compare_exchange_n(&bfs->actor_level[b], &expected, level + 1, 0,
+                                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                                {
+                                    frontier_push(next, b);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            pthread_barrier_wait(&bfs->barrier);
+
+            if (w->index == 0)
+            {
+                total = 0;
+
+                for (t = 0; t < bfs->worker_count; t++)
+                {
+                    q = &bfs->workers[t].queues[bfs->current];
+                    q->size = 0;
+                    q->taken = 0;
+                    total += bfs->workers[t].queues[bfs->current ^ 1].size;
+                }
+
+                bfs->reached += total;
+                bfs->current ^= 1;
+                bfs->level++;
+                bfs->done = (total == 0);
+            }
+
+            pthread_barrier_wait(&bfs->barrier);
+        }
+
+        pthread_barrier_wait(&bfs->pool);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @function create_parallel_bfs
+ *
+ * @brief Initialize a new instance of struct ParallelBfs
+ *
+ * @param g is the graph to search on
+ * @param threads is the number of workers, 0 for one per CPU
+ * @param placement is PLACEMENT_DEFAULT, PLACEMENT_INTERLEAVE or PLACEMENT_REPLICATE
+ * @param pin is 1 to pin workers to CPUs
+ * @return pointer to ParallelBfs instance
+ */
+struct ParallelBfs *create_parallel_bfs(struct Graph *g, int threads, int placement, int pin)
+{
+    struct ParallelBfs *bfs;
+    int i;
+
+    bfs = calloc(1, sizeof(struct ParallelBfs));
+    bfs->graph = g;
+    bfs->placement = placement;
+    bfs->pin = pin;
+
+    detect_topology(&bfs->topology);
+    bfs->worker_count = (threads > 0) ? threads : bfs->topology.cpu_count;
+
+    /* Placement needs more than one node, otherwise every choice is the default */
+    if (bfs->topology.node_count == 1)
+    {
+        placement = PLACEMENT_DEFAULT;
+    }
+
+    bfs->replica_count = (placement == PLACEMENT_REPLICATE) ? bfs->topology.node_count : 1;
+    bfs->replicas = calloc(bfs->replica_count, sizeof(struct GraphReplica));
+
+    for (i = 0; i < bfs->replica_count; i++)
+    {
+        if (placement == PLACEMENT_DEFAULT)
+        {
+            bfs->replicas[i].actor_offsets = g->actor_offsets;
+            bfs->replicas[i].actor_movies = g->actor_movies;
+            bfs->replicas[i].movie_offsets = g->movie_offsets;
+            bfs->replicas[i].movie_actors = g->movie_actors;
+        }
+        else
+        {
+            place_replica(g, &bfs->replicas[i], placement == PLACEMENT_INTERLEAVE ? -1 : i);
+        }
+    }
+
+    /* Written by every worker, so spread over the nodes unless the default is asked */
+    if (placement != PLACEMENT_DEFAULT)
+    {
+        bfs->actor_level = alloc_placed((g->actor_count + 1) * sizeof(int), -1);
+        bfs->movie_seen = alloc_placed(g->movie_count + 1, -1);
+        bfs->placed_state = (bfs->actor_level != NULL && bfs->movie_seen != NULL);
+
+        if (!bfs->placed_state)
+        {
+            free_placed(bfs->actor_level, (g->actor_count + 1) * sizeof(int));
+            free_placed(bfs->movie_seen, g->movie_count + 1);
+        }
+    }
+
+    if (!bfs->placed_state)
+    {
+        bfs->actor_level = malloc((g->actor_count + 1) * sizeof(int));
+        bfs->movie_seen = malloc(g->movie_count + 1);
+    }
+
+    bfs->workers = calloc(bfs->worker_count, sizeof(struct BfsWorker));
+
+    for (i = 0; i < bfs->worker_count; i++)
+    {
+        bfs->workers[i].bfs = bfs;
+        bfs->workers[i].index = i;
+        bfs->workers[i].cpu = pin ? bfs->topology.cpus[i % bfs->topology.cpu_count] : -1;
+        bfs->workers[i].node = bfs->topology.nodes[i % bfs->topology.cpu_count];
+    }
+
+    pthread_barrier_init(&bfs->barrier, NULL, (unsigned) bfs->worker_count);
+    pthread_barrier_init(&bfs->pool, NULL, (unsigned) bfs->worker_count + 1);
+
+    /* The calling thread only waits, so pinning never changes its affinity */
+    for (i = 0; i < bfs->worker_count; i++)
+    {
+        pthread_create(&bfs->workers[i].thread, NULL, bfs_worker, &bfs->workers[i]);
+    }
+
+    return bfs;
+}
+
+
+/**
+ * @function free_parallel_bfs
+ *
+ * @brief Free a parallel BFS and its placed arrays
+ *
+ * @param bfs is the parallel BFS
+ */
+void free_parallel_bfs(struct ParallelBfs *bfs)
+{
+    struct GraphReplica *r;
+    struct Graph *g;
+    int i;
+
+    g = bfs->graph;
+
+    /* Workers waiting for a search see stop and exit */
+    bfs->stop = 1;
+    pthread_barrier_wait(&bfs->pool);
+
+    for (i = 0; i < bfs->worker_count; i++)
+    {
+        pthread_join(bfs->workers[i].thread, NULL);
+    }
+
+    for (i = 0; i < bfs->replica_count; i++)
+    {
+        r = &bfs->replicas[i];
+
+        if (r->size[0] > 0)
+        {
+            free_placed(r->actor_offsets, r->size[0]);
+            free_placed(r->actor_movies, r->size[1]);
+            free_placed(r->movie_offsets, r->size[2]);
+            free_placed(r->movie_actors, r->size[3]);
+        }
+    }
+
+    if (bfs->placed_state)
+    {
+        free_placed(bfs->actor_level, (g->actor_count + 1) * sizeof(int));
+        free_placed(bfs->movie_seen, g->movie_count + 1);
+    }
+    else
+    {
+        free(bfs->actor_level);
+        free(bfs->movie_seen);
+    }
+
+    for (i = 0; i < bfs->worker_count; i++)
+    {
+        free(bfs->workers[i].queues[0].items);
+        free(bfs->workers[i].queues[1].items);
+    }
+
+    pthread_barrier_destroy(&bfs->barrier);
+    pthread_barrier_destroy(&bfs->pool);
+    free(bfs->workers);
+    free(bfs->replicas);
+    free(bfs->topology.cpus);
+    free(bfs->topology.nodes);
+    free(bfs);
+}
+
+
+/**
+ * @function parallel_bfs
+ *
+ * @brief Find the distance of every actor to an actor with all workers
+ *
+ * @discussion
+ * <p>Distances are left in actor_level, and the number of traversed edges in the workers.
+ *
+ * @param bfs is the parallel BFS
+ * @param start is the id of the starting actor
+ * @return number of actors reached, the starting actor excluded
+ */
+long parallel_bfs(struct ParallelBfs *bfs, int start)
+{
+    struct Graph *g;
+    int i;
+
+    g = bfs->graph;
+
+    memset(bfs->actor_level, 0xFF, g->actor_count * sizeof(int));
+    memset(bfs->movie_seen, 0, g->movie_count);
+
+    for (i = 0; i < bfs->worker_count; i++)
+    {
+        bfs->workers[i].queues[0].size = 0;
+        bfs->workers[i].queues[0].taken = 0;
+        bfs->workers[i].queues[1].size = 0;
+        bfs->workers[i].queues[1].taken = 0;
+    }
+
+    bfs->actor_level[start] = 0;
+    frontier_push(&bfs->workers[0].queues[0], start);
+    bfs->current = 0;
+    bfs->level = 0;
+    bfs->done = 0;
+    bfs->reached = 0;
+
+    /* Start the waiting workers, then wait for the last level */
+    pthread_barrier_wait(&bfs->pool);
+    pthread_barrier_wait(&bfs->pool);
+
+    return bfs->reached;
+}
+
+
+/**
+ * @function bfs_levels
+ *
+ * @brief Find the distance of every actor to an actor
+ *
+ * @discussion
+ * <p>This is the plain level synchronous kernel of expand_neighborhood without filters and visit
+ * calls, the baseline of bfs_levels_prefetch. Distances are left in the search context.
+ *
+ * @param ctx is the search context
+ * @param start is the id of the starting actor
+ * @return number of actors reached, the starting actor excluded
+ */
+int bfs_levels(struct SearchContext *ctx, int start)
+{
+    struct Graph *g;
+    int head;
+    int tail;
+    int level_end;
+    int level;
+    int a;
+    int m;
+    int b;
+    int i;
+    int j;
+
+    g = ctx->graph;
+    begin_search(ctx);
+
+    ctx->actor_stamps[start] = ctx->epoch;
+    ctx->actor_level[start] = 0;
+    ctx->queue[0] = start;
+
+    head = 0;
+    tail = 1;
+
+    for (level = 1; head < tail; level++)
+    {
+        level_end = tail;
+
+        for (; head < level_end; head++)
+        {
+            a = ctx->queue[head];
+
+            for (i = g->actor_offsets[a]; i < g->actor_offsets[a + 1]; i++)
+            {
+                m = g->actor_movies[i];
+
+                if (ctx->movie_stamps[m] == ctx->epoch)
+                {
+                    continue;
+                }
+
+                ctx->movie_stamps[m] = ctx->epoch;
+
+                for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+                {
+                    b = g->movie_actors[j];
+
+                    if (ctx->actor_stamps[b] != ctx->epoch)
+                    {
+                        ctx->actor_stamps[b] = ctx->epoch;
+                        ctx->actor_level[b] = level;
+                        ctx->queue[tail++] = b;
+                    }
+                }
+            }
+        }
+    }
+
+    return tail - 1;
+}
+
+
+/**
+ * @function reserve
+ *
+ * @brief Make room in a growable int array
+ *
+ * @return the array, moved if it had to grow
+ */
+static int *reserve(int *array, long *capacity, long needed)
+{
+    if (needed > *capacity)
+    {
+        *capacity = (needed > 2 * *capacity) ? needed : 2 * *capacity;
+        array = realloc(array, *capacity * sizeof(int));
+
+        if (array == NULL)
+        {
+            fprintf(stderr, "BFS allocation error\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return array;
+}
+
+
+/**
+ * @function bfs_levels_prefetch
+ *
+ * @brief Find the distance of every actor to an actor, hiding memory latency
+ *
+ * @discussion
+ * <p>The plain kernel finishes one lookup before it knows the address of the next: the row of an
+ * actor, then the stamp and the row of a movie, then the stamp of every co-star. On graphs larger
+ * than the cache each step is a miss, and only one is in flight at a time. This kernel takes the
+ * frontier in batches of BFS_BATCH actors and splits a batch in stages. Every stage first lists
+ * the addresses the next one reads and prefetches them, so the misses of a whole batch overlap:
+ * <p>1. movies of the batch are listed, their stamps and offsets are prefetched, and the rows of the
+ * next batch are prefetched,
+ * <p>2. movies not visited yet are claimed and their casts are prefetched,
+ * <p>3. actors of the claimed casts are listed and their stamps are prefetched,
+ * <p>4. actors not visited yet are claimed.
+ * <p>Distances are the same as bfs_levels, only the order of actors in a level may differ. The batch
+ * lists are kept in the search context and only grow, so searches after the first do not allocate.
+ *
+ * @param ctx is the search context
+ * @param start is the id of the starting actor
+ * @return number of actors reached, the starting actor excluded
+ */
+int bfs_levels_prefetch(struct SearchContext *ctx, int start)
+{
+    struct Graph *g;
+    unsigned int epoch;
+    int *movies;
+    int *cast;
+    long movie_count;
+    long cast_count;
+    long claimed;
+    long needed;
+    long k;
+    int head;
+    int tail;
+    int level_end;
+    int batch_end;
+    int level;
+    int a;
+    int m;
+    int b;
+    int i;
+    int j;
+
+    g = ctx->graph;
+    begin_search(ctx);
+    epoch = ctx->epoch;
+
+    ctx->actor_stamps[start] = epoch;
+    ctx->actor_level[start] = 0;
+    ctx->queue[0] = start;
+
+    head = 0;
+    tail = 1;
+
+    for (level = 1; head < tail; level++)
+    {
+        level_end = tail;
+
+        for (; head < level_end; head = batch_end)
+        {
+            batch_end = (head + BFS_BATCH < level_end) ? head + BFS_BATCH : level_end;
+
+            /* 1. List movies of the batch, prefetch the next batch's offsets and rows */
+            needed = 0;
+            for (i = head; i < batch_end; i++)
+            {
+                a = ctx->queue[i];
+                needed += g->actor_offsets[a + 1] - g->actor_offsets[a];
+            }
+
+            movies = ctx->batch_movies = reserve(ctx->batch_movies, &ctx->batch_movies_capacity, needed);
+            movie_count = 0;
+
+            for (i = head; i < batch_end; i++)
+            {
+                a = ctx->queue[i];
+
+                if (i + BFS_BATCH < level_end)
+                {
+                    __builtin_prefetch(&g->actor_movies[g->actor_offsets[ctx->queue[i + BFS_BATCH]]]);
+                }
+
+                if (i + 2 * BFS_BATCH < level_end)
+                {
+                    __builtin_prefetch(&g->actor_offsets[ctx->queue[i + 2 * BFS_BATCH]]);
+                }
+
+                for (j = g->actor_offsets[a]; j < g->actor_offsets[a + 1]; j++)
+                {
+                    m = g->actor_movies[j];
+                    movies[movie_count++] = m;
+                    __builtin_prefetch(&ctx->movie_stamps[m]);
+                    __builtin_prefetch(&g->movie_offsets[m]);
+                }
+            }
+
+            /* 2. Claim unvisited movies, prefetch their casts */
+            claimed = 0;
+            needed = 0;
+
+            for (k = 0; k < movie_count; k++)
+            {
+                m = movies[k];
+
+                if (ctx->movie_stamps[m] != epoch)
+                {
+                    ctx->movie_stamps[m] = epoch;
+                    movies[claimed++] = m;
+                    needed += g->movie_offsets[m + 1] - g->movie_offsets[m];
+                    __builtin_prefetch(&g->movie_actors[g->movie_offsets[m]]);
+                }
+            }
+
+            /* 3. List actors of the claimed casts, prefetch their stamps */
+            cast = ctx->batch_cast = reserve(ctx->batch_cast, &ctx->batch_cast_capacity, needed);
+            cast_count = 0;
+
+            for (k = 0; k < claimed; k++)
+            {
+                m = movies[k];
+
+                for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+                {
+                    b = g->movie_actors[j];
+                    cast[cast_count++] = b;
+                    __builtin_prefetch(&ctx->actor_stamps[b], 1);
+                }
+            }
+
+            /* 4. Claim unvisited actors */
+            for (k = 0; k < cast_count; k++)
+            {
+                b = cast[k];
+
+                if (ctx->actor_stamps[b] != epoch)
+                {
+                    ctx->actor_stamps[b] = epoch;
+                    ctx->actor_level[b] = level;
+                    ctx->queue[tail++] = b;
+                }
+            }
+        }
+    }
+
+    return tail - 1;
+}
+
+
+/**
+ * @function same_levels
+ *
+ * @brief Compare the distances of the last search of a context with saved ones
+ *
+ * @param ctx is the search context
+ * @param levels is the saved distance of every actor, -1 for not reached
+ * @return 1 if every actor has the same distance, 0 otherwise
+ */
+static int same_levels(struct SearchContext *ctx, int *levels)
+{
+    int i;
+
+    for (i = 0; i < ctx->graph->actor_count; i++)
+    {
+        if ((ctx->actor_stamps[i] == ctx->epoch ? ctx->actor_level[i] : -1) != levels[i])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @function traversed_edges
+ *
+ * @brief Count the edges a full search of a context read
+ *
+ * @return number of actor row entries of reached actors plus cast entries of reached movies
+ */
+static long traversed_edges(struct SearchContext *ctx)
+{
+    struct Graph *g;
+    long edges;
+    int i;
+
+    g = ctx->graph;
+    edges = 0;
+
+    for (i = 0; i < g->actor_count; i++)
+    {
+        if (ctx->actor_stamps[i] == ctx->epoch)
+        {
+            edges += g->actor_offsets[i + 1] - g->actor_offsets[i];
+        }
+    }
+
+    for (i = 0; i < g->movie_count; i++)
+    {
+        if (ctx->movie_stamps[i] == ctx->epoch)
+        {
+            edges += g->movie_offsets[i + 1] - g->movie_offsets[i];
+        }
+    }
+
+    return edges;
+}
+
+
+/**
+ * @function print_bfs_row
+ *
+ * @brief Print a line of the BFS benchmark table
+ */
+static void print_bfs_row(char *kernel, char *placement, char *pinned, double setup, double best, double total,
+                          long edges, long reached, int same)
+{
+    printf("%-10s %-11s %6s %9.2f %10.2f %10.2f %9.1f %10ld %6s\n", kernel, placement, pinned, setup * 1e3,
+           best * 1e3, total / BFS_BENCH_RUNS * 1e3, best > 0 ? edges / best / 1e6 : 0.0, reached,
+           same ? "ok" : "FAIL");
+}
+
+
+/**
+ * @function benchmark_bfs
+ *
+ * @brief Compare BFS kernels, NUMA placements and pinning
+ *
+ * @discussion
+ * <p>Every kernel and configuration runs BFS_BENCH_RUNS searches from the same actor. Its distances
+ * are checked against the plain serial kernel. Setup of a parallel configuration is the time to place
+ * its arrays and start its workers, so searches are timed without thread creation. The compact graph
+ * is copied here and freed after its runs, its setup is the time of the copy.
+ *
+ * @param ctx is the search context, its last search is overwritten
+ * @param start is the id of the starting actor
+ * @param threads is the number of workers, 0 for one per CPU
+ */
+void benchmark_bfs(struct SearchContext *ctx, int start, int threads)
+{
+    struct ParallelBfs *bfs;
+    struct CompactGraph *compact;
+    struct Graph *g;
+    char *names[3];
+    int *levels;
+    double setup;
+    double best;
+    double total;
+    double started;
+    double elapsed;
+    long serial;
+    long reached;
+    long edges;
+    int placement;
+    int pin;
+    int kernel;
+    int same;
+    int run;
+    int i;
+
+    g = ctx->graph;
+    names[PLACEMENT_DEFAULT] = "default";
+    names[PLACEMENT_INTERLEAVE] = "interleave";
+    names[PLACEMENT_REPLICATE] = "replicate";
+
+    bfs = create_parallel_bfs(g, threads, PLACEMENT_DEFAULT, 0);
+    printf("NUMA nodes: %d, CPUs: %d, workers: %d%s\n", bfs->topology.node_count, bfs->topology.cpu_count,
+           bfs->worker_count,
+#ifdef HAVE_NUMA
+           ""
+#else
+           " (built without libnuma)"
+#endif
+    );
+
+    if (bfs->topology.node_count == 1)
+    {
+        printf("Single NUMA node: interleave and replicate place memory like the default\n");
+    }
+
+    free_parallel_bfs(bfs);
+
+    started = now_seconds();
+    compact = build_compact_graph(g);
+    setup = now_seconds() - started;
+
+    printf("Compact graph: %s ids/offsets, %.1f MB (%.1f MB with int ids and distances)\n",
+           compact_variant_name(compact), compact->bytes / 1e6,
+           ((g->actor_count + 1.0) * 3 + (g->movie_count + 1.0) + 2.0 * g->actor_offsets[g->actor_count]) *
+           sizeof(int) / 1e6);
+
+    /* Reference distances of the plain kernel */
+    serial = bfs_levels(ctx, start);
+    edges = traversed_edges(ctx);
+    levels = malloc((g->actor_count + 1) * sizeof(int));
+
+    for (i = 0; i < g->actor_count; i++)
+    {
+        levels[i] = (ctx->actor_stamps[i] == ctx->epoch) ? ctx->actor_level[i] : -1;
+    }
+
+    printf("%-10s %-11s %6s %9s %10s %10s %9s %10s %6s\n", "Kernel", "Placement", "Pinned", "Setup ms", "Best ms",
+           "Mean ms", "MTEPS", "Reached", "Check");
+
+    for (kernel = 0; kernel < 2; kernel++)
+    {
+        best = 0;
+        total = 0;
+        reached = 0;
+
+        for (run = 0; run < BFS_BENCH_RUNS; run++)
+        {
+            started = now_seconds();
+            reached = (kernel == 0) ? bfs_levels(ctx, start) : bfs_levels_prefetch(ctx, start);
+            elapsed = now_seconds() - started;
+
+            total += elapsed;
+            if (run == 0 || elapsed < best)
+            {
+                best = elapsed;
+            }
+        }
+
+        print_bfs_row(kernel == 0 ? "plain" : "prefetch", "-", "-", 0, best, total, edges, reached,
+                      reached == serial && same_levels(ctx, levels));
+    }
+
+    best = 0;
+    total = 0;
+    reached = 0;
+
+    for (run = 0; run < BFS_BENCH_RUNS; run++)
+    {
+        started = now_seconds();
+        reached = compact_bfs(compact, start);
+        elapsed = now_seconds() - started;
+
+        total += elapsed;
+        if (run == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+
+    /* Byte distances saturate */
+    same = (reached == serial);
+    for (i = 0; i < g->actor_count && same; i++)
+    {
+        same = (compact->distance[i] == UNREACHED) ? levels[i] == -1 :
+               compact->distance[i] == (levels[i] < UNREACHED - 1 ? levels[i] : UNREACHED - 1);
+    }
+
+    print_bfs_row("compact", compact_variant_name(compact), "-", setup, best, total, edges, reached, same);
+    free_compact_graph(compact);
+
+    for (placement = PLACEMENT_DEFAULT; placement <= PLACEMENT_REPLICATE; placement++)
+    {
+        for (pin = (placement == PLACEMENT_DEFAULT) ? 0 : 1; pin <= 1; pin++)
+        {
+            started = now_seconds();
+            bfs = create_parallel_bfs(g, threads, placement, pin);
+            setup = now_seconds() - started;
+
+            best = 0;
+            total = 0;
+            reached = 0;
+
+            for (run = 0; run < BFS_BENCH_RUNS; run++)
+            {
+                started = now_seconds();
+                reached = parallel_bfs(bfs, start);
+                elapsed = now_seconds() - started;
+
+                total += elapsed;
+                if (run == 0 || elapsed < best)
+                {
+                    best = elapsed;
+                }
+            }
+
+            /* Distances of the last run against the plain kernel */
+            same = (reached == serial);
+            for (i = 0; i < g->actor_count && same; i++)
+            {
+                same = (bfs->actor_level[i] == levels[i]);
+            }
+
+            print_bfs_row("parallel", names[placement], pin ? "yes" : "no", setup, best, total, edges, reached,
+                          same);
+
+            free_parallel_bfs(bfs);
+        }
+    }
+
+    free(levels);
+}
+
+
+/**
+ * @function radix_bucket
+ *
+ * @brief Find the bucket of a key
+ *
+ * @return 0 if the key equals the last popped key, 1 + the highest bit they differ otherwise
+ */
+static int radix_bucket(struct RadixHeap *h, uint32_t key)
+{
+    return (key == h->last) ? 0 : 32 - __builtin_clz(key ^ h->last);
+}
+
+
+/**
+ * @function radix_bucket_add
+ *
+ * @brief Append an entry to a bucket
+ */
+static void radix_bucket_add(struct RadixHeap *h, int bucket, uint32_t key, int value)
+{
+    if (h->counts[bucket] == h->capacities[bucket])
+    {
+        h->capacities[bucket] = (h->capacities[bucket] > 0) ? 2 * h->capacities[bucket] : 64;
+        h->keys[bucket] = realloc(h->keys[bucket], h->capacities[bucket] * sizeof(uint32_t));
+        h->values[bucket] = realloc(h->values[bucket], h->capacities[bucket] * sizeof(int));
+
+        if (h->keys[bucket] == NULL || h->values[bucket] == NULL)
+        {
+            fprintf(stderr, "Heap allocation error\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    h->keys[bucket][h->counts[bucket]] = key;
+    h->values[bucket][h->counts[bucket]] = value;
+    h->counts[bucket]++;
+}
+
+
+/**
+ * @function radix_heap_push
+ *
+ * @brief Insert an entry to a radix heap
+ *
+ * @param h is the heap
+ * @param key is the key, it must not be smaller than the last popped key
+ * @param value is the value
+ */
+void radix_heap_push(struct RadixHeap *h, uint32_t key, int value)
+{
+    radix_bucket_add(h, radix_bucket(h, key), key, value);
+    h->size++;
+}
+
+
+/**
+ * @function radix_heap_pop
+ *
+ * @brief Remove an entry with the smallest key from a radix heap
+ *
+ * @param h is the heap
+ * @param key is set to the key of the entry
+ * @return value of the entry, -1 if the heap is empty
+ */
+int radix_heap_pop(struct RadixHeap *h, uint32_t *key)
+{
+    uint32_t min;
+    long n;
+    long k;
+    int i;
+
+    if (h->size == 0)
+    {
+        return -1;
+    }
+
+    if (h->counts[0] == 0)
+    {
+        i = 1;
+        while (h->counts[i] == 0)
+        {
+            i++;
+        }
+
+        min = h->keys[i][0];
+        for (k = 1; k < h->counts[i]; k++)
+        {
+            if (h->keys[i][k] < min)
+            {
+                min = h->keys[i][k];
+            }
+        }
+
+        /* Every entry of bucket i goes to a lower bucket around the new last key */
+        h->last = min;
+        n = h->counts[i];
+        h->counts[i] = 0;
+
+        for (k = 0; k < n; k++)
+        {
+            radix_bucket_add(h, radix_bucket(h, h->keys[i][k]), h->keys[i][k], h->values[i][k]);
+        }
+    }
+
+    h->size--;
+    h->counts[0]--;
+    *key = h->keys[0][h->counts[0]];
+
+    return h->values[0][h->counts[0]];
+}
+
+
+/**
+ * @function radix_heap_clear
+ *
+ * @brief Remove every entry of a radix heap, keeping its buffers
+ *
+ * @param h is the heap
+ */
+void radix_heap_clear(struct RadixHeap *h)
+{
+    int i;
+
+    for (i = 0; i < RADIX_BUCKETS; i++)
+    {
+        h->counts[i] = 0;
+    }
+
+    h->size = 0;
+    h->last = 0;
+}
+
+
+/**
+ * @function log2_floor
+ *
+ * @brief Integer logarithm, 0 for 0 and 1
+ */
+static int log2_floor(unsigned int n)
+{
+    return (n > 1) ? 31 - __builtin_clz(n) : 0;
+}
+
+
+/**
+ * @function create_weighted_graph
+ *
+ * @brief Initialize a new instance of struct WeightedGraph
+ *
+ * @discussion
+ * <p>Actor rows are the transpose of movie rows in movie id order, as build_graph makes them, so
+ * walking movie rows in the same order finds the position of every actor row entry in its movie.
+ *
+ * @param g is the graph
+ * @return pointer to WeightedGraph instance
+ */
+struct WeightedGraph *create_weighted_graph(struct Graph *g)
+{
+    struct WeightedGraph *w;
+    int *fill;
+    int cast_cost;
+    int m;
+    int j;
+
+    w = calloc(1, sizeof(struct WeightedGraph));
+    w->graph = g;
+    w->actor_costs = malloc(g->actor_offsets[g->actor_count] + 1);
+    w->actor_dist = malloc((g->actor_count + 1) * sizeof(uint32_t));
+    w->movie_dist = malloc((g->movie_count + 1) * sizeof(uint32_t));
+    w->movie_parent = malloc((g->movie_count + 1) * sizeof(int));
+    fill = malloc((g->actor_count + 1) * sizeof(int));
+
+    if (w->actor_costs == NULL || w->actor_dist == NULL || w->movie_dist == NULL || w->movie_parent == NULL ||
+        fill == NULL)
+    {
+        fprintf(stderr, "Graph allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(fill, g->actor_offsets, g->actor_count * sizeof(int));
+
+    for (m = 0; m < g->movie_count; m++)
+    {
+        cast_cost = 1 + log2_floor((unsigned int) (g->movie_offsets[m + 1] - g->movie_offsets[m]));
+
+        for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+        {
+            w->actor_costs[fill[g->movie_actors[j]]++] =
+                (unsigned char) (cast_cost + log2_floor((unsigned int) (j - g->movie_offsets[m] + 1)));
+        }
+    }
+
+    free(fill);
+
+    return w;
+}
+
+
+/**
+ * @function free_weighted_graph
+ *
+ * @brief Free a weighted graph
+ *
+ * @param w is the weighted graph
+ */
+void free_weighted_graph(struct WeightedGraph *w)
+{
+    int i;
+
+    for (i = 0; i < RADIX_BUCKETS; i++)
+    {
+        free(w->heap.keys[i]);
+        free(w->heap.values[i]);
+    }
+
+    free(w->actor_costs);
+    free(w->actor_dist);
+    free(w->movie_dist);
+    free(w->movie_parent);
+    free(w);
+}
+
+
+/**
+ * @function find_strongest_link
+ *
+ * @brief Find the cheapest chain between two actors
+ *
+ * @discussion
+ * <p>This function runs Dijkstra on actors and movies with the costs of struct WeightedGraph. Costs
+ * are small integers, so the priority queue is a radix heap. The search stops when the ending actor
+ * is popped. After a successful search the chain can be printed with print_path.
+ *
+ * @param w is the weighted graph
+ * @param ctx is the search context, its stamps and parents are used
+ * @param start is the id of the starting actor
+ * @param end is the id of the ending actor
+ * @param hops is set to the number of movies in the chain
+ * @return cost of the chain, -1 if there is no connection, SEARCH_STOPPED if a limit is reached, the
+ * cost is at least lower_bound of the context then
+ */
+long find_strongest_link(struct WeightedGraph *w, struct SearchContext *ctx, int start, int end, int *hops)
+{
+    struct Graph *g;
+    uint32_t key;
+    uint32_t cost;
+    int node;
+    int m;
+    int b;
+    int i;
+    int j;
+
+    g = w->graph;
+
+    if (g->actor_components[start] != g->actor_components[end])
+    {
+        return -1;
+    }
+
+    begin_search(ctx);
+    radix_heap_clear(&w->heap);
+
+    ctx->actor_stamps[start] = ctx->epoch;
+    ctx->parent[start] = -1;
+    ctx->parent_movie[start] = -1;
+    w->actor_dist[start] = 0;
+    radix_heap_push(&w->heap, 0, start);
+
+    while ((node = radix_heap_pop(&w->heap, &key)) != -1)
+    {
+        if (node < g->actor_count)
+        {
+            /* Stale entry of an actor reached cheaper later */
+            if (key != w->actor_dist[node])
+            {
+                continue;
+            }
+
+            if (node == end)
+            {
+                *hops = 0;
+                for (b = end; ctx->parent[b] != -1; b = ctx->parent[b])
+                {
+                    (*hops)++;
+                }
+
+                return (long) key;
+            }
+
+            /* Every cheaper chain is already popped */
+            if (search_stopped(ctx))
+            {
+                ctx->lower_bound = (long) key;
+                return SEARCH_STOPPED;
+            }
+
+            for (i = g->actor_offsets[node]; i < g->actor_offsets[node + 1]; i++)
+            {
+                m = g->actor_movies[i];
+                cost = key + w->actor_costs[i];
+
+                if (ctx->movie_stamps[m] != ctx->epoch || cost < w->movie_dist[m])
+                {
+                    ctx->movie_stamps[m] = ctx->epoch;
+                    w->movie_dist[m] = cost;
+                    w->movie_parent[m] = node;
+                    radix_heap_push(&w->heap, cost, g->actor_count + m);
+                }
+            }
+        }
+        else
+        {
+            m = node - g->actor_count;
+
+            if (key != w->movie_dist[m])
+            {
+                continue;
+            }
+
+            for (j = g->movie_offsets[m]; j < g->movie_offsets[m + 1]; j++)
+            {
+                b = g->movie_actors[j];
+                cost = key + (uint32_t) log2_floor((unsigned int) (j - g->movie_offsets[m] + 1));
+
+                if (ctx->actor_stamps[b] != ctx->epoch || cost < w->actor_dist[b])
+                {
+                    ctx->actor_stamps[b] = ctx->epoch;
+                    w->actor_dist[b] = cost;
+                    ctx->parent[b] = w->movie_parent[m];
+                    ctx->parent_movie[b] = m;
+                    radix_heap_push(&w->heap, cost, b);
+                }
+            }
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @function centrality_source
+ *
+ * @brief Add the dependencies and distances of one source
+ *
+ * @discussion
+ * <p>This is one step of Brandes' algorithm. A BFS counts shortest paths to every node, then nodes
+ * are visited in the reverse order and each one passes its dependency to its predecessors in
+ * proportion to their path counts. Predecessors are not stored, they are the neighbors one level
+ * closer. Only actors are path ends, so only an actor adds one for itself.
+ */
+static void centrality_source(struct CentralityWorker *w, int source)
+{
+    struct Graph *g;
+    double coefficient;
+    int head;
+    int tail;
+    int actors;
+    int v;
+    int u;
+    int i;
+    int begin;
+    int end;
+    int *row;
+    int offset;
+
+    g = w->job->graph;
+    actors = g->actor_count;
+
+    w->dist[source] = 0;
+    w->sigma[source] = 1;
+    w->order[0] = source;
+    head = 0;
+    tail = 1;
+
+    while (head < tail)
+    {
+        v = w->order[head++];
+
+        if (v < actors)
+        {
+            begin = g->actor_offsets[v];
+            end = g->actor_offsets[v + 1];
+            row = g->actor_movies;
+            offset = actors;
+        }
+        else
+        {
+            begin = g->movie_offsets[v - actors];
+            end = g->movie_offsets[v - actors + 1];
+            row = g->movie_actors;
+            offset = 0;
+        }
+
+        for (i = begin; i < end; i++)
+        {
+            u = row[i] + offset;
+
+            if (w->dist[u] < 0)
+            {
+                w->dist[u] = w->dist[v] + 1;
+                w->order[tail++] = u;
+            }
+
+            if (w->dist[u] == w->dist[v] + 1)
+            {
+                w->sigma[u] += w->sigma[v];
+            }
+        }
+    }
+
+    while (--tail > 0)
+    {
+        v = w->order[tail];
+        coefficient = ((v < actors ? 1.0 : 0.0) + w->delta[v]) / w->sigma[v];
+
+        if (v < actors)
+        {
+            begin = g->actor_offsets[v];
+            end = g->actor_offsets[v + 1];
+            row = g->actor_movies;
+            offset = actors;
+
+            w->betweenness[v] += w->delta[v];
+            w->farness[v] += w->dist[v] / 2;
+            w->reached[v]++;
+        }
+        else
+        {
+            begin = g->movie_offsets[v - actors];
+            end = g->movie_offsets[v - actors + 1];
+            row = g->movie_actors;
+            offset = 0;
+        }
+
+        for (i = begin; i < end; i++)
+        {
+            u = row[i] + offset;
+
+            if (w->dist[u] == w->dist[v] - 1)
+            {
+                w->delta[u] += w->sigma[u] * coefficient;
+            }
+        }
+    }
+
+    /* Reset what this source wrote; head is the number of reached nodes */
+    for (i = 0; i < head; i++)
+    {
+        v = w->order[i];
+        w->dist[v] = -1;
+        w->sigma[v] = 0;
+        w->delta[v] = 0;
+    }
+}
+
+
+/**
+ * @function centrality_worker
+ *
+ * @brief Worker thread of the centrality computation
+ *
+ * @param arg is the struct CentralityWorker instance
+ * @return NULL
+ */
+static void *centrality_worker(void *arg)
+{
+    struct CentralityWorker *w;
+    struct CentralityJob *job;
+    long i;
+
+    w = arg;
+    job = w->job;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->source_count)
+    {
+        centrality_source(w, job->sources[i]);
+        __atomic_fetch_add(&job->done, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @function next_random
+ *
+ * @brief Draw a number from a seeded generator
+ *
+ * @discussion
+ * <p>This is xorshift64*, so a seed gives the same sample and the same self check cases on every
+ * machine.
+ *
+ * @param state is the generator state, it must not be 0
+ * @param n is the number of possible values
+ * @return number in [0, n)
+ */
+static int next_random(uint64_t *state, int n)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return (int) (((*state * UINT64_C(2685821657736338717)) >> 33) % (uint64_t) (n > 0 ? n : 1));
+}
+
+
+/**
+ * @function compute_centrality
+ *
+ * @brief Compute betweenness and closeness of every actor
+ *
+ * @discussion
+ * <p>With epsilon 0 every actor is a source and the result is exact. Otherwise sources are sampled
+ * uniformly without replacement. A source adds at most n - 2 to the betweenness of an actor, so by
+ * Hoeffding's inequality and the union bound over n actors, ln(2n / delta) / (2 epsilon^2) sources
+ * keep every normalized betweenness, betweenness / (n (n - 2) / 2), within epsilon with probability
+ * 1 - delta. When that many sources are not fewer than the actors, the result is exact. Closeness
+ * is estimated from the same sources. Progress is printed while workers run.
+ *
+ * @param g is the graph
+ * @param epsilon is the error bound, 0 for the exact result
+ * @param threads is the number of workers, 0 for one per CPU
+ * @param seed is the seed of the sample, not 0
+ * @return pointer to CentralityResult instance
+ */
+struct CentralityResult *compute_centrality(struct Graph *g, double epsilon, int threads, uint64_t seed)
+{
+    struct CentralityResult *r;
+    struct CentralityWorker *workers;
+    struct CentralityJob job;
+    struct timespec pause;
+    double started;
+    double elapsed;
+    double last_report;
+    double scale;
+    double samples;
+    double farness;
+    unsigned char *chosen;
+    uint64_t state;
+    long reached;
+    long done;
+    long n;
+    long i;
+    long j;
+    int running;
+    int t;
+    int tmp;
+
+    started = now_seconds();
+    n = g->actor_count;
+
+    r = calloc(1, sizeof(struct CentralityResult));
+    r->betweenness = calloc(n + 1, sizeof(double));
+    r->closeness = calloc(n + 1, sizeof(double));
+    r->epsilon = epsilon;
+    r->delta = CENTRALITY_DELTA;
+    r->seed = seed;
+
+    samples = (epsilon > 0) ? ceil(log(2.0 * n / CENTRALITY_DELTA) / (2 * epsilon * epsilon)) : (double) n;
+    r->exact = (samples >= n);
+    r->sources = r->exact ? n : (long) samples;
+
+    /* Partial Fisher-Yates shuffle, the first sources entries are the sample */
+    job.graph = g;
+    job.sources = malloc((n + 1) * sizeof(int));
+    job.source_count = r->sources;
+    job.next = 0;
+    job.done = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        job.sources[i] = (int) i;
+    }
+
+    if (!r->exact)
+    {
+        state = seed;
+
+        for (i = 0; i < r->sources; i++)
+        {
+            j = i + next_random(&state, (int) (n - i));
+            tmp = job.sources[i];
+            job.sources[i] = job.sources[j];
+            job.sources[j] = tmp;
+        }
+    }
+
+    if (threads <= 0)
+    {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    workers = calloc(threads, sizeof(struct CentralityWorker));
+
+    for (t = 0; t < threads; t++)
+    {
+        workers[t].job = &job;
+        workers[t].dist = malloc((n + g->movie_count + 1) * sizeof(int));
+        workers[t].sigma = calloc(n + g->movie_count + 1, sizeof(double));
+        workers[t].delta = calloc(n + g->movie_count + 1, sizeof(double));
+        workers[t].order = malloc((n + g->movie_count + 1) * sizeof(int));
+        workers[t].betweenness = calloc(n + 1, sizeof(double));
+        workers[t].farness = calloc(n + 1, sizeof(double));
+        workers[t].reached = calloc(n + 1, sizeof(int));
+
+        if (workers[t].dist == NULL || workers[t].sigma == NULL || workers[t].delta == NULL ||
+            workers[t].order == NULL || workers[t].betweenness == NULL || workers[t].farness == NULL ||
+            workers[t].reached == NULL)
+        {
+            fprintf(stderr, "Centrality allocation error\n");
+            exit(EXIT_FAILURE);
+        }
+
+        memset(workers[t].dist, 0xFF, (n + g->movie_count + 1) * sizeof(int));
+    }
+
+    /* Workers pull sources from the job, so fewer workers still cover all of them */
+    for (running = 0; running < threads; running++)
+    {
+        if (pthread_create(&workers[running].thread, NULL, centrality_worker, &workers[running]) != 0)
+        {
+            fprintf(stderr, "Started %d of %d centrality workers\n", running, threads);
+            break;
+        }
+    }
+
+    if (running == 0)
+    {
+        centrality_worker(&workers[0]);
+    }
+
+    /* Progress report */
+    pause.tv_sec = 0;
+    pause.tv_nsec = 100000000;
+    last_report = started;
+
+    while ((done = __atomic_load_n(&job.done, __ATOMIC_RELAXED)) < job.source_count)
+    {
+        nanosleep(&pause, NULL);
+        elapsed = now_seconds() - started;
+
+        if (now_seconds() - last_report >= CENTRALITY_PROGRESS_SECONDS && done > 0)
+        {
+            last_report = now_seconds();
+            printf("Progress: %ld / %ld sources (%.1f%%), %.1f s elapsed, ETA %.1f s\n", done, job.source_count,
+                   100.0 * done / job.source_count, elapsed, elapsed / done * (job.source_count - done));
+            fflush(stdout);
+        }
+    }
+
+    for (t = 0; t < running; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+    }
+
+    /* Undirected pairs are counted from both ends */
+    scale = (double) n / r->sources / 2;
+
+    chosen = calloc(n + 1, 1);
+    for (i = 0; i < r->sources; i++)
+    {
+        chosen[job.sources[i]] = 1;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        farness = 0;
+        reached = 0;
+
+        for (t = 0; t < threads; t++)
+        {
+            r->betweenness[i] += workers[t].betweenness[i];
+            farness += workers[t].farness[i];
+            reached += workers[t].reached[i];
+        }
+
+        r->betweenness[i] *= scale;
+
+        /* Reached fraction of the sources other than the actor, over the average distance */
+        if (farness > 0)
+        {
+            r->closeness[i] = (double) reached / (r->sources - chosen[i]) * reached / farness;
+        }
+    }
+
+    free(chosen);
+
+    for (t = 0; t < threads; t++)
+    {
+        free(workers[t].dist);
+        free(workers[t].sigma);
+        free(workers[t].delta);
+        free(workers[t].order);
+        free(workers[t].betweenness);
+        free(workers[t].farness);
+        free(workers[t].reached);
+    }
+
+    free(workers);
+    free(job.sources);
+
+    r->elapsed = now_seconds() - started;
+
+    return r;
+}
+
+
+/**
+ * @function free_centrality
+ *
+ * @brief Free a centrality result
+ *
+ * @param r is the centrality result
+ */
+void free_centrality(struct CentralityResult *r)
+{
+    free(r->betweenness);
+    free(r->closeness);
+    free(r);
+}
+
+
+/**
+ * @function top_scores
+ *
+ * @brief Find the ids of the k largest scores
+ *
+ * @discussion
+ * <p>A min heap of the best k ids seen is kept, then sorted in place from the largest score.
+ *
+ * @return number of ids found, less than k only if n is less than k
+ */
+static int top_scores(double *scores, int n, int k, int *ids)
+{
+    int size;
+    int i;
+    int j;
+    int c;
+    int tmp;
+
+    size = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        if (size == k && scores[i] <= scores[ids[0]])
+        {
+            continue;
+        }
+
+        if (size < k)
+        {
+            /* Sift up */
+            j = size++;
+            ids[j] = i;
+
+            while (j > 0 && scores[ids[(j - 1) / 2]] > scores[ids[j]])
+            {
+                tmp = ids[j];
+                ids[j] = ids[(j - 1) / 2];
+                ids[(j - 1) / 2] = tmp;
+                j = (j - 1) / 2;
+            }
+
+            continue;
+        }
+
+        /* Replace the smallest and sift down */
+        ids[0] = i;
+        j = 0;
+
+        while ((c = 2 * j + 1) < size)
+        {
+            if (c + 1 < size && scores[ids[c + 1]] < scores[ids[c]])
+            {
+                c++;
+            }
+
+            if (scores[ids[c]] >= scores[ids[j]])
+            {
+                break;
+            }
+
+            tmp = ids[j];
+            ids[j] = ids[c];
+            ids[c] = tmp;
+            j = c;
+        }
+    }
+
+    /* Heap sort, the smallest goes to the end */
+    for (i = size - 1; i > 0; i--)
+    {
+        tmp = ids[0];
+        ids[0] = ids[i];
+        ids[i] = tmp;
+        j = 0;
+
+        while ((c = 2 * j + 1) < i)
+        {
+            if (c + 1 < i && scores[ids[c + 1]] < scores[ids[c]])
+            {
+                c++;
+            }
+
+            if (scores[ids[c]] >= scores[ids[j]])
+            {
+                break;
+            }
+
+            tmp = ids[j];
+            ids[j] = ids[c];
+            ids[c] = tmp;
+            j = c;
+        }
+    }
+
+    return size;
+}
+
+
+/**
+ * @function print_top_centrality
+ *
+ * @brief Print the actors with the highest betweenness and closeness
+ *
+ * @param g is the graph
+ * @param r is the centrality result
+ * @param k is the number of actors to print of each ranking
+ */
+void print_top_centrality(struct Graph *g, struct CentralityResult *r, int k)
+{
+    double pairs;
+    int *ids;
+    int count;
+    int i;
+
+    if (r->exact)
+    {
+        printf("Exact centrality from all %ld actors in %.3f s\n", r->sources, r->elapsed);
+    }
+    else
+    {
+        printf("Centrality from %ld sampled actors of %d in %.3f s (seed %llu)\n", r->sources, g->actor_count,
+               r->elapsed, (unsigned long long) r->seed);
+        printf("Normalized betweenness is within %g of the exact value with probability %g\n", r->epsilon,
+               1 - r->delta);
+    }
+
+    ids = malloc((k + 1) * sizeof(int));
+    pairs = (double) g->actor_count * (g->actor_count - 2) / 2;
+
+    count = top_scores(r->betweenness, g->actor_count, k, ids);
+    printf("%-5s %16s %12s  %s\n", "Rank", "Betweenness", "Normalized", "Actor");
+
+    for (i = 0; i < count; i++)
+    {
+        printf("%-5d %16.1f %12.6f  %s\n", i + 1, r->betweenness[ids[i]],
+               pairs > 0 ? r->betweenness[ids[i]] / pairs : 0.0, g->actor_names[ids[i]]);
+    }
+
+    count = top_scores(r->closeness, g->actor_count, k, ids);
+    printf("%-5s %16s  %s\n", "Rank", "Closeness", "Actor");
+
+    for (i = 0; i < count; i++)
+    {
+        printf("%-5d %16.6f  %s\n", i + 1, r->closeness[ids[i]], g->actor_names[ids[i]]);
+    }
+
+    free(ids);
+}
+
+
+/**
+ * @define COMPACT_GRAPH_KERNELS
+ * @abstract defines the build, free and BFS functions of a COMPACT_GRAPH_TYPE struct
+ *
+ * @discussion name##_build copies the rows of struct Graph with the widths of the type and returns
+ * the bytes it allocated. name##_bfs is the plain level synchronous BFS with byte distances, the
+ * distances must be UNREACHED and the movie bitset must be clear when it is called.
+ */
+#define COMPACT_GRAPH_KERNELS(name, id_type, offset_type) \
+static long name##_build(struct name *c, struct Graph *g) \
+{ \
+    long edges; \
+    long i; \
+    \
+    edges = g->actor_offsets[g->actor_count]; \
+    c->actor_offsets = malloc((g->actor_count + 1) * sizeof(offset_type)); \
+    c->actor_movies = malloc((edges + 1) * sizeof(id_type)); \
+    c->movie_offsets = malloc((g->movie_count + 1) * sizeof(offset_type)); \
+    c->movie_actors = malloc((edges + 1) * sizeof(id_type)); \
+    c->queue = malloc((g->actor_count + 1) * sizeof(id_type)); \
+    \
+    if (c->actor_offsets == NULL || c->actor_movies == NULL || c->movie_offsets == NULL || \
+        c->movie_actors == NULL || c->queue == NULL) \
+    { \
+        fprintf(stderr, "Graph allocation error\n"); \
+        exit(EXIT_FAILURE); \
+    } \
+    \
+    for (i = 0; i <= g->actor_count; i++) \
+    { \
+        c->actor_offsets[i] = (offset_type) g->actor_offsets[i]; \
+    } \
+    \
+    for (i = 0; i <= g->movie_count; i++) \
+    { \
+        c->movie_offsets[i] = (offset_type) g->movie_offsets[i]; \
+    } \
+    \
+    for (i = 0; i < edges; i++) \
+    { \
+        c->actor_movies[i] = (id_type) g->actor_movies[i]; \
+        c->movie_actors[i] = (id_type) g->movie_actors[i]; \
+    } \
+    \
+    return (g->actor_count + g->movie_count + 2) * (long) sizeof(offset_type) + \
+           (2 * edges + g->actor_count) * (long) sizeof(id_type); \
+} \
+\
+static void name##_free(struct name *c) \
+{ \
+    free(c->actor_offsets); \
+    free(c->actor_movies); \
+    free(c->movie_offsets); \
+    free(c->movie_actors); \
+    free(c->queue); \
+} \
+\
+static long name##_bfs(struct name *c, int start, unsigned char *distance, unsigned long *movie_seen) \
+{ \
+    offset_type i; \
+    offset_type j; \
+    id_type a; \
+    id_type m; \
+    id_type b; \
+    long head; \
+    long tail; \
+    long level_end; \
+    unsigned char level; \
+    \
+    distance[start] = 0; \
+    c->queue[0] = (id_type) start; \
+    head = 0; \
+    tail = 1; \
+    level = 0; \
+    \
+    while (head < tail) \
+    { \
+        level_end = tail; \
+        level = (level < UNREACHED - 1) ? level + 1 : level; \
+        \
+        for (; head < level_end; head++) \
+        { \
+            a = c->queue[head]; \
+            \
+            for (i = c->actor_offsets[a]; i < c->actor_offsets[a + 1]; i++) \
+            { \
+                m = c->actor_movies[i]; \
+                \
+                if (BITSET_TEST(movie_seen, m)) \
+                { \
+                    continue; \
+                } \
+                \
+                BITSET_SET(movie_seen, m); \
+                \
+                for (j = c->movie_offsets[m]; j < c->movie_offsets[m + 1]; j++) \
+                { \
+                    b = c->movie_actors[j]; \
+                    \
+                    if (distance[b] == UNREACHED) \
+                    { \
+                        distance[b] = level; \
+                        c->queue[tail++] = b; \
+                    } \
+                } \
+            } \
+        } \
+    } \
+    \
+    return tail - 1; \
+}
+
+COMPACT_GRAPH_KERNELS(CompactGraph16, uint16_t, uint32_t)
+COMPACT_GRAPH_KERNELS(CompactGraph32, uint32_t, uint32_t)
+
+
+/**
+ * @function build_compact_graph
+ *
+ * @brief Copy a graph to the smallest compact variant it fits in
+ *
+ * @param g is the graph
+ * @return pointer to CompactGraph instance
+ */
+struct CompactGraph *build_compact_graph(struct Graph *g)
+{
+    struct CompactGraph *c;
+
+    c = calloc(1, sizeof(struct CompactGraph));
+    c->actor_count = g->actor_count;
+    c->movie_count = g->movie_count;
+
+    if (g->actor_count <= UINT16_MAX && g->movie_count <= UINT16_MAX)
+    {
+        c->variant = COMPACT_IDS16;
+        c->bytes = CompactGraph16_build(&c->graph.ids16, g);
+    }
+    else
+    {
+        c->variant = COMPACT_IDS32;
+        c->bytes = CompactGraph32_build(&c->graph.ids32, g);
+    }
+
+    c->distance = malloc(g->actor_count + 1);
+    c->movie_seen = calloc(BITSET_WORDS(g->movie_count) + 1, sizeof(unsigned long));
+
+    if (c->distance == NULL || c->movie_seen == NULL)
+    {
+        fprintf(stderr, "Graph allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    c->bytes += g->actor_count + (long) (BITSET_WORDS(g->movie_count) * sizeof(unsigned long));
+
+    return c;
+}
+
+
+/**
+ * @function free_compact_graph
+ *
+ * @brief Free a compact graph
+ *
+ * @param c is the compact graph
+ */
+void free_compact_graph(struct CompactGraph *c)
+{
+    switch (c->variant)
+    {
+        case COMPACT_IDS16:
+            CompactGraph16_free(&c->graph.ids16);
+            break;
+        default:
+            CompactGraph32_free(&c->graph.ids32);
+            break;
+    }
+
+    free(c->distance);
+    free(c->movie_seen);
+    free(c);
+}
+
+
+/**
+ * @function compact_bfs
+ *
+ * @brief Find the distance of every actor to an actor on a compact graph
+ *
+ * @discussion
+ * <p>Distances are left in the distance array of the compact graph.
+ *
+ * @param c is the compact graph
+ * @param start is the id of the starting actor
+ * @return number of actors reached, the starting actor excluded
+ */
+long compact_bfs(struct CompactGraph *c, int start)
+{
+    memset(c->distance, UNREACHED, c->actor_count);
+    memset(c->movie_seen, 0, BITSET_WORDS(c->movie_count) * sizeof(unsigned long));
+
+    switch (c->variant)
+    {
+        case COMPACT_IDS16:
+            return CompactGraph16_bfs(&c->graph.ids16, start, c->distance, c->movie_seen);
+        default:
+            return CompactGraph32_bfs(&c->graph.ids32, start, c->distance, c->movie_seen);
+    }
+}
+
+
+/**
+ * @function compact_variant_name
+ *
+ * @brief Describe the id and offset widths of a compact graph
+ *
+ * @param c is the compact graph
+ * @return name of the variant
+ */
+char *compact_variant_name(struct CompactGraph *c)
+{
+    switch (c->variant)
+    {
+        case COMPACT_IDS16:
+            return "16/32 bit";
+        default:
+            return "32/32 bit";
+    }
+}
+
+
+/**
+ * @function add_check_line
+ *
+ * @brief Append a movie line to a case
+ *
+ * @param c is the case
+ * @param title is the title id
+ * @param cast is the actor ids of the line
+ * @param count is the number of actor ids
+ */
+static void add_check_line(struct CheckCase *c, int title, int *cast, int count)
+{
+    int end;
+
+    end = c->line_offsets[c->line_count];
+
+    if (c->line_count + 2 > c->line_capacity)
+    {
+        c->line_capacity *= 2;
+        c->titles = realloc(c->titles, c->line_capacity * sizeof(int));
+        c->line_offsets = realloc(c->line_offsets, c->line_capacity * sizeof(int));
+    }
+
+    while (end + count > c->cast_capacity)
+    {
+        c->cast_capacity *= 2;
+        c->cast = realloc(c->cast, c->cast_capacity * sizeof(int));
+    }
+
+    if (c->titles == NULL || c->line_offsets == NULL || c->cast == NULL)
+    {
+        fprintf(stderr, "Case allocation error\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(c->cast + end, cast, count * sizeof(int));
+    c->titles[c->line_count] = title;
+    c->line_offsets[++c->line_count] = end + count;
+
+    if (title >= c->title_count)
+    {
+        c->title_count = title + 1;
+    }
+}
+
+
+/**
+ * @function create_check_case
+ *
+ * @brief Initialize an empty case
+ *
+ * @param actor_count is the number of actor ids
+ * @param has_bacon is 1 if actor 0 is named Bacon, Kevin
+ * @return pointer to CheckCase instance
+ */
+static struct CheckCase *create_check_case(int actor_count, int has_bacon)
+{
+    struct CheckCase *c;
+
+    c = calloc(1, sizeof(struct CheckCase));
+    c->line_capacity = 16;
+    c->cast_capacity = 64;
+    c->titles = malloc(c->line_capacity * sizeof(int));
+    c->line_offsets = malloc(c->line_capacity * sizeof(int));
+    c->cast = malloc(c->cast_capacity * sizeof(int));
+    c->line_offsets[0] = 0;
+    c->actor_count = actor_count;
+    c->has_bacon = has_bacon;
+    c->format_seed = 1;
+
+    return c;
+}
+
+
+/**
+ * @function generate_check_case
+ *
+ * @brief Generate a random case of a shape
+ *
+ * @discussion
+ * <p>Shapes are the inputs a fast engine tends to get wrong: SHAPE_HUB has movies with most of the
+ * actors, SHAPE_COMPONENTS has disconnected groups, single actor and empty movies, SHAPE_DUPLICATES
+ * repeats titles, lines and actors inside a line, SHAPE_LONG_LINES has lines longer than a tokenizer
+ * block with long names, SHAPE_NO_BACON has no Bacon, Kevin, and SHAPE_CHAIN is deeper than a byte
+ * distance can hold.
+ *
+ * @param seed is the generator state
+ * @param shape is one of the SHAPE_ values
+ * @return pointer to CheckCase instance
+ */
+struct CheckCase *generate_check_case(uint64_t *seed, int shape)
+{
+    struct CheckCase *c;
+    int *cast;
+    int actors;
+    int lines;
+    int groups;
+    int group;
+    int count;
+    int size;
+    int i;
+    int j;
+
+    switch (shape)
+    {
+        case SHAPE_HUB:
+            actors = 50 + next_random(seed, 500);
+            lines = next_random(seed, 100);
+            break;
+        case SHAPE_LONG_LINES:
+            actors = 1000 + next_random(seed, 3000);
+            lines = 2 + next_random(seed, 8);
+            break;
+        case SHAPE_CHAIN:
+            actors = UNREACHED + next_random(seed, 60);
+            lines = next_random(seed, 40);
+            break;
+        default:
+            actors = 2 + next_random(seed, 300);
+            lines = 1 + next_random(seed, 250);
+            break;
+    }
+
+    c = create_check_case(actors, shape != SHAPE_NO_BACON);
+    c->format_seed = (uint64_t) next_random(seed, INT32_MAX) + 1;
+    cast = malloc((actors + 3000) * 2 * sizeof(int));
+    groups = 2 + next_random(seed, 6);
+
+    if (shape == SHAPE_LONG_LINES)
+    {
+        c->name_padding = 80 + next_random(seed, 200);
+    }
+
+    /* A path through every actor, then lines hanging off it */
+    if (shape == SHAPE_CHAIN)
+    {
+        for (i = 0; i + 1 < actors; i++)
+        {
+            cast[0] = i;
+            cast[1] = i + 1;
+            add_check_line(c, c->title_count, cast, 2);
+        }
+    }
+
+    for (i = 0; i < lines; i++)
+    {
+        size = 1 + next_random(seed, 6);
+
+        if (shape == SHAPE_LONG_LINES)
+        {
+            size = 500 + next_random(seed, 2500);
+        }
+        else if (shape == SHAPE_COMPONENTS)
+        {
+            size = next_random(seed, 5);
+        }
+        else if (shape == SHAPE_CHAIN)
+        {
+            size = 2;
+        }
+
+        group = next_random(seed, groups);
+        count = 0;
+
+        for (j = 0; j < size; j++)
+        {
+            if (shape == SHAPE_COMPONENTS)
+            {
+                /* Every group has the actors of one remainder */
+                cast[count] = group + groups * next_random(seed, (actors - group + groups - 1) / groups);
+                count += (cast[count] < actors);
+            }
+            else if (shape == SHAPE_CHAIN)
+            {
+                cast[count++] = (j == 0) ? next_random(seed, actors) : actors + next_random(seed, actors);
+            }
+            else
+            {
+                cast[count++] = next_random(seed, actors);
+            }
+
+            if (shape == SHAPE_DUPLICATES && count > 0 && next_random(seed, 3) == 0)
+            {
+                cast[count] = cast[count - 1];
+                count++;
+            }
+        }
+
+        if (shape == SHAPE_DUPLICATES && c->line_count > 0 && next_random(seed, 4) == 0)
+        {
+            /* The same line again */
+            j = next_random(seed, c->line_count);
+            count = c->line_offsets[j + 1] - c->line_offsets[j];
+            memcpy(cast, c->cast + c->line_offsets[j], count * sizeof(int));
+            add_check_line(c, c->titles[j], cast, count);
+            continue;
+        }
+
+        add_check_line(c, shape == SHAPE_DUPLICATES ? next_random(seed, lines / 3 + 1) : c->title_count, cast, count);
+    }
+
+    if (shape == SHAPE_CHAIN)
+    {
+        /* Hanging actors have ids above the chain */
+        c->actor_count = actors * 2;
+    }
+
+    if (shape == SHAPE_HUB)
+    {
+        for (i = next_random(seed, 3); i >= 0; i--)
+        {
+            count = 0;
+            size = 1 + next_random(seed, 4);
+
+            for (j = 0; j < actors; j++)
+            {
+                if (next_random(seed, size) != 0)
+                {
+                    cast[count++] = j;
+                }
+            }
+
+            add_check_line(c, c->title_count, cast, count);
+        }
+    }
+
+    free(cast);
+
+    return c;
+}
+
+
+/**
+ * @function free_check_case
+ *
+ * @brief Free a case
+ *
+ * @param c is the case
+ */
+void free_check_case(struct CheckCase *c)
+{
+    free(c->titles);
+    free(c->line_offsets);
+    free(c->cast);
+    free(c);
+}
+
+
+/**
+ * @function copy_check_case
+ *
+ * @brief Copy a case without some of its lines or one cast entry
+ *
+ * @param c is the case
+ * @param skip_line is the first line to leave out
+ * @param skip_count is the number of lines to leave out
+ * @param skip_cast is the index of the cast entry to leave out, -1 for none
+ * @return pointer to CheckCase instance
+ */
+static struct CheckCase *copy_check_case(struct CheckCase *c, int skip_line, int skip_count, int skip_cast)
+{
+    struct CheckCase *copy;
+    int *cast;
+    int count;
+    int i;
+    int j;
+
+    copy = create_check_case(c->actor_count, c->has_bacon);
+    copy->name_padding = c->name_padding;
+    copy->format_seed = c->format_seed;
+    cast = malloc((c->line_offsets[c->line_count] + 1) * sizeof(int));
+
+    for (i = 0; i < c->line_count; i++)
+    {
+        if (i >= skip_line && i < skip_line + skip_count)
+        {
+            continue;
+        }
+
+        count = 0;
+        for (j = c->line_offsets[i]; j < c->line_offsets[i + 1]; j++)
+        {
+            if (j != skip_cast)
+            {
+                cast[count++] = c->cast[j];
+            }
+        }
+
+        add_check_line(copy, c->titles[i], cast, count);
+    }
+
+    copy->title_count = c->title_count;
+    free(cast);
+
+    return copy;
+}
+
+
+/**
+ * @function check_name
+ *
+ * @brief Make the name of an actor or a title of a case
+ *
+ * @param c is the case
+ * @param id is the actor or title id
+ * @param is_title is 1 for a title
+ * @return the name, to be freed by the caller
+ */
+static char *check_name(struct CheckCase *c, int id, int is_title)
+{
+    char *name;
+    int length;
+
+    name = malloc(64 + c->name_padding);
+
+    if (is_title)
+    {
+        if (id % 7 == 0)
+        {
+            sprintf(name, "Movie %d", id);
+        }
+        else
+        {
+            sprintf(name, "Movie %d (%d)", id, 1900 + id % 120);
+        }
+    }
+    else if (id == 0 && c->has_bacon)
+    {
+        strcpy(name, "Bacon, Kevin");
+    }
+    else
+    {
+        /* Some names are not ASCII */
+        length = sprintf(name, "%s %d, Test", id % 5 == 0 ? "Zo\xc3\xab" : "Actor", id);
+        memset(name + length, 'a' + id % 26, c->name_padding);
+        name[length + c->name_padding] = '\0';
+    }
+
+    return name;
+}
+
+
+/**
+ * @function find_check_key
+ *
+ * @brief Find a name in a sorted array of names
+ *
+ * @param keys is the sorted names
+ * @param count is the number of names
+ * @param name is the name to find
+ * @return id of the name, -1 if it is not in the array
+ */
+static int find_check_key(struct FoldedKey *keys, int count, char *name)
+{
+    int low;
+    int high;
+    int middle;
+    int result;
+
+    low = 0;
+    high = count - 1;
+
+    while (low <= high)
+    {
+        middle = low + (high - low) / 2;
+        result = strcmp(keys[middle].key, name);
+
+        if (result == 0)
+        {
+            return keys[middle].id;
+        }
+
+        if (result < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @function create_check_reference
+ *
+ * @brief Initialize a new instance of struct CheckReference
+ *
+ * @param c is the case
+ * @return pointer to CheckReference instance
+ */
+struct CheckReference *create_check_reference(struct CheckCase *c)
+{
+    struct CheckReference *ref;
+    int *fill;
+    int n;
+    int i;
+    int j;
+
+    ref = calloc(1, sizeof(struct CheckReference));
+    ref->c = c;
+    n = c->actor_count + 1;
+
+    ref->names = malloc(n * sizeof(char*));
+    ref->titles = malloc((c->title_count + 1) * sizeof(char*));
+    ref->actor_keys = malloc(n * sizeof(struct FoldedKey));
+    ref->title_keys = malloc((c->title_count + 1) * sizeof(struct FoldedKey));
+    ref->present = calloc(n, sizeof(int));
+    ref->actor_offsets = calloc(n + 1, sizeof(int));
+    ref->actor_lines = malloc((c->line_offsets[c->line_count] + 1) * sizeof(int));
+    ref->level = malloc(n * sizeof(int));
+    ref->paths = malloc(n * sizeof(uint64_t));
+    ref->marks = calloc(n, sizeof(int));
+    ref->line_stamps = calloc(c->line_count + 1, sizeof(int));
+    ref->queue = malloc(n * sizeof(int));
+    ref->line_queue = malloc((c->line_count + 1) * sizeof(int));
+    ref->positions = malloc((c->line_offsets[c->line_count] + 1) * sizeof(int));
+    ref->line_sizes = malloc((c->line_count + 1) * sizeof(int));
+    ref->actor_positions = malloc((c->line_offsets[c->line_count] + 1) * sizeof(int));
+    ref->cost = malloc(n * sizeof(long));
+    ref->line_cost = malloc((c->line_count + 1) * sizeof(long));
+    ref->heap_keys = malloc((2 * c->line_offsets[c->line_count] + 2) * sizeof(long));
+    ref->heap_nodes = malloc((2 * c->line_offsets[c->line_count] + 2) * sizeof(int));
+    fill = malloc((n + 1) * sizeof(int));
+
+    for (i = 0; i < n; i++)
+    {
+        ref->names[i] = check_name(c, i, 0);
+        ref->actor_keys[i].key = ref->names[i];
+        ref->actor_keys[i].id = i;
+    }
+
+    for (i = 0; i < c->title_count; i++)
+    {
+        ref->titles[i] = check_name(c, i, 1);
+        ref->title_keys[i].key = ref->titles[i];
+        ref->title_keys[i].id = i;
+    }
+
+    qsort(ref->actor_keys, n, sizeof(struct FoldedKey), compare_folded_keys);
+    qsort(ref->title_keys, c->title_count, sizeof(struct FoldedKey), compare_folded_keys);
+
+    /* Billing positions, fill holds the position of each actor in the current line */
+    for (i = 0; i < c->line_count; i++)
+    {
+        ref->mark++;
+        ref->line_sizes[i] = 0;
+
+        for (j = c->line_offsets[i]; j < c->line_offsets[i + 1]; j++)
+        {
+            if (ref->marks[c->cast[j]] != ref->mark)
+            {
+                ref->marks[c->cast[j]] = ref->mark;
+                fill[c->cast[j]] = ref->line_sizes[i]++;
+            }
+
+            ref->positions[j] = fill[c->cast[j]];
+        }
+    }
+
+    /* Lines of every actor, a line twice if the actor is written twice */
+    for (i = 0; i < c->line_offsets[c->line_count]; i++)
+    {
+        ref->present[c->cast[i]]++;
+        ref->actor_offsets[c->cast[i] + 1]++;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        ref->actor_offsets[i + 1] += ref->actor_offsets[i];
+    }
+
+    memcpy(fill, ref->actor_offsets, n * sizeof(int));
+
+    for (i = 0; i < c->line_count; i++)
+    {
+        for (j = c->line_offsets[i]; j < c->line_offsets[i + 1]; j++)
+        {
+            ref->actor_positions[fill[c->cast[j]]] = ref->positions[j];
+            ref->actor_lines[fill[c->cast[j]]++] = i;
+        }
+    }
+
+    free(fill);
+
+    return ref;
+}
+
+
+/**
+ * @function free_check_reference
+ *
+ * @brief Free a struct CheckReference instance
+ *
+ * @param ref is the reference
+ */
+void free_check_reference(struct CheckReference *ref)
+{
+    int i;
+
+    for (i = 0; i <= ref->c->actor_count; i++)
+    {
+        free(ref->names[i]);
+    }
+
+    for (i = 0; i < ref->c->title_count; i++)
+    {
+        free(ref->titles[i]);
+    }
+
+    free(ref->names);
+    free(ref->titles);
+    free(ref->actor_keys);
+    free(ref->title_keys);
+    free(ref->present);
+    free(ref->actor_offsets);
+    free(ref->actor_lines);
+    free(ref->level);
+    free(ref->paths);
+    free(ref->marks);
+    free(ref->line_stamps);
+    free(ref->queue);
+    free(ref->line_queue);
+    free(ref->positions);
+    free(ref->line_sizes);
+    free(ref->actor_positions);
+    free(ref->cost);
+    free(ref->line_cost);
+    free(ref->heap_keys);
+    free(ref->heap_nodes);
+    free(ref);
+}
+
+
+/**
+ * @function reference_bfs
+ *
+ * @brief Find the distance and shortest path count of every actor to an actor of a case
+ *
+ * @discussion
+ * <p>Every line is a movie, even if its title is written on another line too. The lines of a level are
+ * listed first, then each line passes the path count of its actors at that level to its actors one
+ * level further. Every actor is counted once per line.
+ *
+ * @param ref is the reference
+ * @param start is the case id of the starting actor
+ */
+void reference_bfs(struct CheckReference *ref, int start)
+{
+    struct CheckCase *c;
+    uint64_t sum;
+    int head;
+    int tail;
+    int level_end;
+    int line_count;
+    int level;
+    int line;
+    int a;
+    int i;
+    int j;
+    int k;
+
+    c = ref->c;
+
+    for (a = 0; a <= c->actor_count; a++)
+    {
+        ref->level[a] = -1;
+        ref->paths[a] = 0;
+    }
+
+    if (!ref->present[start])
+    {
+        return;
+    }
+
+    ref->level[start] = 0;
+    ref->paths[start] = 1;
+    ref->queue[0] = start;
+    ref->epoch++;
+
+    head = 0;
+    tail = 1;
+    level = 0;
+
+    while (head < tail)
+    {
+        level_end = tail;
+        line_count = 0;
+
+        for (; head < level_end; head++)
+        {
+            a = ref->queue[head];
+
+            for (k = ref->actor_offsets[a]; k < ref->actor_offsets[a + 1]; k++)
+            {
+                line = ref->actor_lines[k];
+
+                if (ref->line_stamps[line] != ref->epoch)
+                {
+                    ref->line_stamps[line] = ref->epoch;
+                    ref->line_queue[line_count++] = line;
+                }
+            }
+        }
+
+        for (i = 0; i < line_count; i++)
+        {
+            line = ref->line_queue[i];
+            sum = 0;
+            ref->mark++;
+
+            for (j = c->line_offsets[line]; j < c->line_offsets[line + 1]; j++)
+            {
+                a = c->cast[j];
+
+                if (ref->marks[a] != ref->mark && ref->level[a] == level)
+                {
+                    sum = saturating_add(sum, ref->paths[a]);
+                }
+
+                ref->marks[a] = ref->mark;
+            }
+
+            ref->mark++;
+
+            for (j = c->line_offsets[line]; j < c->line_offsets[line + 1]; j++)
+            {
+                a = c->cast[j];
+
+                if (ref->marks[a] == ref->mark)
+                {
+                    continue;
+                }
+
+                ref->marks[a] = ref->mark;
+
+                if (ref->level[a] == -1)
+                {
+                    ref->level[a] = level + 1;
+                    ref->queue[tail++] = a;
+                }
+
+                if (ref->level[a] == level + 1)
+                {
+                    ref->paths[a] = saturating_add(ref->paths[a], sum);
+                }
+            }
+        }
+
+        level++;
     }
+}
 
-    fclose(fptr);
 
-    return lines;
+/**
+ * @function reference_push
+ *
+ * @brief Add an entry to the binary heap of the reference Dijkstra
+ *
+ * @param ref is the reference
+ * @param key is the cost of the entry
+ * @param node is the actor or line of the entry
+ */
+static void reference_push(struct CheckReference *ref, long key, int node)
+{
+    int i;
+
+    for (i = ref->heap_size++; i > 0 && ref->heap_keys[(i - 1) / 2] > key; i = (i - 1) / 2)
+    {
+        ref->heap_keys[i] = ref->heap_keys[(i - 1) / 2];
+        ref->heap_nodes[i] = ref->heap_nodes[(i - 1) / 2];
+    }
+
+    ref->heap_keys[i] = key;
+    ref->heap_nodes[i] = node;
 }
 
 
 /**
- * @function parse_line
+ * @function reference_pop
  *
- * @brief Tokenize a string
+ * @brief Remove the cheapest entry of the binary heap of the reference Dijkstra
+ *
+ * @param ref is the reference, its heap must not be empty
+ * @param node is set to the actor or line of the entry
+ * @return cost of the entry
+ */
+static long reference_pop(struct CheckReference *ref, int *node)
+{
+    long top;
+    long key;
+    int child;
+    int i;
+
+    top = ref->heap_keys[0];
+    *node = ref->heap_nodes[0];
+    key = ref->heap_keys[--ref->heap_size];
+
+    for (i = 0; (child = 2 * i + 1) < ref->heap_size; i = child)
+    {
+        if (child + 1 < ref->heap_size && ref->heap_keys[child + 1] < ref->heap_keys[child])
+        {
+            child++;
+        }
+
+        if (ref->heap_keys[child] >= key)
+        {
+            break;
+        }
+
+        ref->heap_keys[i] = ref->heap_keys[child];
+        ref->heap_nodes[i] = ref->heap_nodes[child];
+    }
+
+    ref->heap_keys[i] = key;
+    ref->heap_nodes[i] = ref->heap_nodes[ref->heap_size];
+
+    return top;
+}
+
+
+/**
+ * @function reference_dijkstra
+ *
+ * @brief Find the cost of the cheapest chain of every actor to an actor of a case
  *
  * @discussion
- * <p>This function tokenize a line and returns a pointer to tokenized string array.
+ * <p>Costs are the ones of struct WeightedGraph, worked out from the case: entering a line costs
+ * 1 + log2 of its number of different actors plus log2 of the billing position plus one of the actor
+ * leaving, and leaving it costs log2 of the billing position plus one of the actor reached. This is
+ * plain Dijkstra with a binary heap, stale entries are skipped.
  *
- * @param line is the string to tokenize
- * @return array of string (tokens)
+ * @param ref is the reference
+ * @param start is the case id of the starting actor
  */
-char **parse_line(char *line)
+void reference_dijkstra(struct CheckReference *ref, int start)
 {
-    int buffer_size;
+    struct CheckCase *c;
+    long key;
+    long next;
+    int node;
+    int line;
+    int n;
+    int a;
+    int j;
+
+    c = ref->c;
+    n = c->actor_count + 1;
+
+    for (a = 0; a < n; a++)
+    {
+        ref->cost[a] = -1;
+    }
+
+    for (line = 0; line < c->line_count; line++)
+    {
+        ref->line_cost[line] = -1;
+    }
+
+    if (!ref->present[start])
+    {
+        return;
+    }
+
+    ref->cost[start] = 0;
+    ref->heap_size = 0;
+    reference_push(ref, 0, start);
+
+    while (ref->heap_size > 0)
+    {
+        key = reference_pop(ref, &node);
+
+        if (node < n)
+        {
+            if (key != ref->cost[node])
+            {
+                continue;
+            }
+
+            for (j = ref->actor_offsets[node]; j < ref->actor_offsets[node + 1]; j++)
+            {
+                line = ref->actor_lines[j];
+                next = key + 1 + log2_floor((unsigned int) ref->line_sizes[line]) +
+                       log2_floor((unsigned int) ref->actor_positions[j] + 1);
+
+                if (ref->line_cost[line] == -1 || next < ref->line_cost[line])
+                {
+                    ref->line_cost[line] = next;
+                    reference_push(ref, next, n + line);
+                }
+            }
+        }
+        else
+        {
+            line = node - n;
+
+            if (key != ref->line_cost[line])
+            {
+                continue;
+            }
+
+            for (j = c->line_offsets[line]; j < c->line_offsets[line + 1]; j++)
+            {
+                a = c->cast[j];
+                next = key + log2_floor((unsigned int) ref->positions[j] + 1);
+
+                if (ref->cost[a] == -1 || next < ref->cost[a])
+                {
+                    ref->cost[a] = next;
+                    reference_push(ref, next, a);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @function check_case_text
+ *
+ * @brief Write a case in the input file format
+ *
+ * @discussion
+ * <p>Empty tokens are skipped by the tokenizer, so lines randomly start or end with a delimiter,
+ * have doubled delimiters, and blank or delimiter only lines are put between them. The last line may
+ * not end with a new line.
+ *
+ * @param c is the case
+ * @param ref is the reference of the case, for the names
+ * @param size is set to the size of the text
+ * @return the text, to be freed by the caller
+ */
+static char *check_case_text(struct CheckCase *c, struct CheckReference *ref, long *size)
+{
+    uint64_t format;
+    char *text;
+    long capacity;
+    long length;
+    long needed;
     int i;
-    char **tokens;
-    char *token;
+    int j;
 
-    buffer_size = 64;
-    i = 0;
+    format = c->format_seed;
+    capacity = 4096;
+    text = malloc(capacity);
+    length = 0;
+
+    for (i = 0; i < c->line_count; i++)
+    {
+        needed = length + (long) strlen(ref->titles[c->titles[i]]) + 16 +
+                 (c->line_offsets[i + 1] - c->line_offsets[i]) * (long) (64 + c->name_padding);
+
+        while (needed > capacity)
+        {
+            capacity *= 2;
+            text = realloc(text, capacity);
+        }
+
+        if (next_random(&format, 8) == 0)
+        {
+            length += sprintf(text + length, next_random(&format, 2) ? "\n" : "//\n");
+        }
+
+        if (next_random(&format, 6) == 0)
+        {
+            text[length++] = '/';
+        }
+
+        length += sprintf(text + length, "%s", ref->titles[c->titles[i]]);
+
+        for (j = c->line_offsets[i]; j < c->line_offsets[i + 1]; j++)
+        {
+            length += sprintf(text + length, next_random(&format, 6) ? "/%s" : "//%s", ref->names[c->cast[j]]);
+        }
+
+        if (next_random(&format, 6) == 0)
+        {
+            text[length++] = '/';
+        }
+
+        if (i + 1 < c->line_count || next_random(&format, 3) != 0)
+        {
+            text[length++] = '\n';
+        }
+    }
+
+    text[length] = '\0';
+    *size = length;
+
+    return text;
+}
+
+
+/**
+ * @function write_check_case
+ *
+ * @brief Write a case to a plain or compressed file
+ *
+ * @param c is the case
+ * @param ref is the reference of the case, for the names
+ * @param path is the file path
+ * @param format is INPUT_PLAIN, INPUT_GZIP or INPUT_ZSTD
+ * @return 0 on success, -1 if the file can not be written or the format is not supported
+ */
+int write_check_case(struct CheckCase *c, struct CheckReference *ref, char *path, int format)
+{
+    FILE *f;
+    char *text;
+    char *data;
+    long size;
+    long written;
+    int error;
+#ifdef HAVE_ZLIB
+    gzFile gz;
+#endif
+#ifdef HAVE_ZSTD
+    size_t bound;
+#endif
+
+    text = check_case_text(c, ref, &size);
+    data = text;
+    written = size;
+    error = 0;
+
+    if (format == INPUT_GZIP)
+    {
+#ifdef HAVE_ZLIB
+        gz = gzopen(path, "wb");
+        error = (gz == NULL);
+
+        if (!error)
+        {
+            error = (size > 0 && gzwrite(gz, text, (unsigned) size) == 0);
+            error |= (gzclose(gz) != Z_OK);
+        }
+#else
+        error = 1;
+#endif
+        free(text);
+        return error ? -1 : 0;
+    }
+
+    if (format == INPUT_ZSTD)
+    {
+#ifdef HAVE_ZSTD
+        bound = ZSTD_compressBound((size_t) size);
+        data = malloc(bound);
+        written = (long) ZSTD_compress(data, bound, text, (size_t) size, 1);
+        error = ZSTD_isError((size_t) written);
+#else
+        error = 1;
+#endif
+    }
+
+    if (!error)
+    {
+        f = fopen(path, "wb");
+        error = (f == NULL);
+
+        if (!error)
+        {
+            error = ((long) fwrite(data, 1, written, f) != written);
+            error |= (fclose(f) != 0);
+        }
+    }
+
+    if (data != text)
+    {
+        free(data);
+    }
+
+    free(text);
+
+    return error ? -1 : 0;
+}
+
+
+/**
+ * @function quiet_stdout
+ *
+ * @brief Send stdout to /dev/null or back
+ *
+ * @discussion
+ * <p>The legacy searches print their paths, the self check runs them with stdout sent away.
+ *
+ * @param saved is -1 to silence stdout, or the descriptor a previous call returned to restore it
+ * @return the descriptor to restore, -1 after restoring
+ */
+static int quiet_stdout(int saved)
+{
+    int fd;
+
+    fflush(stdout);
+
+    if (saved == -1)
+    {
+        saved = dup(STDOUT_FILENO);
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd >= 0)
+        {
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+        }
+
+        return saved;
+    }
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    return -1;
+}
+
+
+/**
+ * @function check_scanners
+ *
+ * @brief Compare the tokens of every delimiter scanner with the lines of a case
+ *
+ * @param c is the case
+ * @param ref is the reference of the case
+ * @param text is the case in the input file format
+ * @param size is the size of the text
+ * @param failure is set to the description of the first difference
+ * @return 0 if every scanner gives the tokens of the case, 1 otherwise
+ */
+static int check_scanners(struct CheckCase *c, struct CheckReference *ref, char *text, long size, char *failure)
+{
+    struct DelimiterScanner scanner[MAX_DELIMITER_SCANNERS];
+    struct Chunk chunk;
+    char *expected;
+    long token;
+    int scanners;
+    int failed;
+    int i;
+    int line;
+    int j;
+
+    scanners = delimiter_scanners(scanner);
+    failed = 0;
+
+    for (i = 0; i < scanners && !failed; i++)
+    {
+        memset(&chunk, 0, sizeof(struct Chunk));
+        chunk.data = malloc(size + 1);
+        chunk.size = size;
+        memcpy(chunk.data, text, size + 1);
+
+        tokenize_chunk(&chunk, &scanner[i]);
+
+        token = 0;
+
+        for (line = 0; line < c->line_count && !failed; line++)
+        {
+            for (j = c->line_offsets[line] - 1; j <= c->line_offsets[line + 1] && !failed; j++, token++)
+            {
+                if (j < c->line_offsets[line])
+                {
+                    expected = ref->titles[c->titles[line]];
+                }
+                else
+                {
+                    expected = (j < c->line_offsets[line + 1]) ? ref->names[c->cast[j]] : NULL;
+                }
+
+                failed = token >= chunk.token_count || (expected == NULL) != (chunk.tokens[token] == NULL) ||
+                         (expected != NULL && strcmp(expected, chunk.tokens[token]) != 0);
+
+                if (failed)
+                {
+                    snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s scanner: token %ld of line %d is \"%.80s\", "
+                             "expected \"%.80s\"", scanner[i].name, token, line,
+                             token < chunk.token_count && chunk.tokens[token] != NULL ? chunk.tokens[token]
+                                                                                     : "(end of line)",
+                             expected != NULL ? expected : "(end of line)");
+                }
+            }
+        }
+
+        if (!failed && (token != chunk.token_count || chunk.record_count != c->line_count))
+        {
+            failed = 1;
+            snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s scanner: %ld tokens and %ld lines, expected %ld and %d",
+                     scanner[i].name, chunk.token_count, chunk.record_count, token, c->line_count);
+        }
+
+        free(chunk.tokens);
+        free(chunk.data);
+    }
+
+    return failed;
+}
+
+
+/**
+ * @function check_hop
+ *
+ * @brief Check that two actors play in a movie of a case
+ *
+ * @param ref is the reference of the case
+ * @param movie is the movie name
+ * @param a is the name of the first actor
+ * @param b is the name of the second actor
+ * @return 1 if a line with the title has both actors, 0 otherwise
+ */
+static int check_hop(struct CheckReference *ref, char *movie, char *a, char *b)
+{
+    struct CheckCase *c;
+    int title;
+    int x;
+    int y;
+    int found;
+    int line;
+    int j;
 
-    tokens = malloc(buffer_size * sizeof(char*));
+    c = ref->c;
+    title = find_check_key(ref->title_keys, c->title_count, movie);
+    x = find_check_key(ref->actor_keys, c->actor_count + 1, a);
+    y = find_check_key(ref->actor_keys, c->actor_count + 1, b);
 
-    /* Memory allocation control */
-    if (tokens == NULL)
+    if (title == -1 || x == -1 || y == -1 || x == y)
     {
-        fprintf(stderr, "Token allocation error\n");
-        exit(EXIT_FAILURE);
+        return 0;
     }
 
-    /* Get first token */
-    token = strtok(line, TOKEN_DELIMITER);
-
-    while (token != NULL)
+    for (line = 0; line < c->line_count; line++)
     {
-        tokens[i] = token;
-        i++;
-
-        if (i >= buffer_size)
+        if (c->titles[line] != title)
         {
-            /* Reallocation of the tokens array */
-            buffer_size += 64;
-            tokens = realloc(tokens, buffer_size * sizeof(char*));
+            continue;
+        }
 
-            /* Memory allocation control */
-            if (!tokens)
-            {
-                fprintf(stderr, "Token allocation error\n");
-                exit(EXIT_FAILURE);
-            }
+        found = 0;
+        for (j = c->line_offsets[line]; j < c->line_offsets[line + 1]; j++)
+        {
+            found |= (c->cast[j] == x) | ((c->cast[j] == y) << 1);
         }
 
-        /* Read next token */
-        token = strtok(NULL, TOKEN_DELIMITER);
+        if (found == 3)
+        {
+            return 1;
+        }
     }
 
-    tokens[i] = NULL;
-
-    return tokens;
+    return 0;
 }
 
 
 /**
- * @function create_hash_table
+ * @function check_parent_path
  *
- * @brief Initialize a new instance of struct HashTable
- *
- * @discussion
- * <p>This function allocates memory for a new instance of struct HashTable, then initializes
- * fields and returns a pointer to new instance.
+ * @brief Check the path a search left in the parents of a context
  *
- * @param m is the size of the hash table
- * @return pointer to HashTable instance
+ * @param e is the engines
+ * @param ref is the reference of the case
+ * @param start is the graph id of the starting actor
+ * @param end is the graph id of the ending actor
+ * @param length is the expected number of movies on the path
+ * @return 1 if the path has length movies, every hop is in the case and it ends at start, 0 otherwise
  */
-struct HashTable *create_hash_table(int m)
+static int check_parent_path(struct CheckEngines *e, struct CheckReference *ref, int start, int end, int length)
 {
-    int i;
-    struct HashTable *ht;
+    struct Graph *g;
+    int hops;
+    int a;
 
-    ht = malloc(m * sizeof(struct HashTable));
-    ht->table_size = m;
+    g = e->g;
+    hops = 0;
 
-    for (i = 0; i < m; i++)
+    for (a = end; e->ctx->parent[a] != -1 && hops <= length; a = e->ctx->parent[a])
     {
-        ht[i].table_size = m;
-        ht[i].head = NULL;
-        ht[i].count = 0;
+        if (!check_hop(ref, g->movie_names[e->ctx->parent_movie[a]], g->actor_names[a],
+                       g->actor_names[e->ctx->parent[a]]))
+        {
+            return 0;
+        }
+
+        hops++;
     }
 
-    return ht;
+    return a == start && hops == length;
 }
 
 
 /**
- * @function create_movie
- *
- * @brief Initialize a new instance of struct Movie
+ * @function check_cursor_paths
  *
- * @discussion
- * <p>This function allocates memory for a new instance of struct Movie, then initializes
- * fields and returns a pointer to new instance.
+ * @brief Check every path of a path cursor
  *
- * @param name is the movie's name
- * @return pointer to Movie instance
+ * @param e is the engines, count_shortest_paths must be the last search of the context
+ * @param ref is the reference of the case
+ * @param start is the graph id of the starting actor
+ * @param end is the graph id of the ending actor
+ * @param distance is the distance of the actors
+ * @return number of valid paths, -1 if a path is not valid
  */
-struct Movie *create_movie(char *name)
+static long check_cursor_paths(struct CheckEngines *e, struct CheckReference *ref, int start, int end, int distance)
 {
+    struct PathCursor *cursor;
+    struct Graph *g;
+    long count;
+    int valid;
     int i;
-    struct Movie *m;
-
-    m = malloc(sizeof(struct Movie));
 
-    m->name = name;
-    m->actor_count = 1;
-    m->actors = malloc(m->actor_count * sizeof(char*));
+    g = e->g;
+    cursor = create_path_cursor(e->ctx, end, distance);
+    count = 0;
+    valid = 1;
 
-    for (i = 0; i < m->actor_count; i++)
+    if (path_cursor_seek(cursor, 0))
     {
-        m->actors[i] = malloc(MAX_INPUT * sizeof(char));
+        do
+        {
+            valid = cursor->actors[0] == end && cursor->actors[distance] == start;
+
+            for (i = 0; i < distance && valid; i++)
+            {
+                valid = check_hop(ref, g->movie_names[cursor->movies[i]], g->actor_names[cursor->actors[i]],
+                                  g->actor_names[cursor->actors[i + 1]]);
+            }
+
+            count++;
+        } while (valid && count <= SELF_CHECK_PATH_LIMIT && path_cursor_next(cursor));
     }
 
-    m->is_visited = 0;
+    free_path_cursor(cursor);
 
-    return m;
+    return valid ? count : -1;
 }
 
 
 /**
- * @function create_actor
+ * @function check_visit
  *
- * @brief Initialize a new instance of struct Actor
+ * @brief Visit function of expand_neighborhood for the self check
  *
  * @discussion
- * <p>This function allocates memory for a new instance of struct Actor, then initializes
- * fields and returns a pointer to new instance.
- *
- * @param name is the actor's name
- * @return pointer to Actor instance
+ * <p>The level of every listed actor is written to the array passed as data.
  */
-struct Actor *create_actor(char *name)
+static void check_visit(int level, int level_size, int *ids, int count, void *data)
 {
+    int *found;
     int i;
-    struct Actor *a;
 
-    a = (struct Actor*) malloc(sizeof(struct Actor));
-
-    a->name = name;
-    a->movie_count = 1;
-    a->movies = malloc(a->movie_count * sizeof(char*));
+    (void) level_size;
+    found = data;
 
-    for (i = 0; i < a->movie_count; i++)
+    for (i = 0; i < count; i++)
     {
-        a->movies[i] = malloc(MAX_INPUT * sizeof(char));
+        found[ids[i]] = level;
     }
-
-    a->is_visited = 0;
-    a->parent_movie_name = malloc(MAX_INPUT * sizeof(char));
-    a->parent = NULL;
-
-    return a;
 }
 
 
 /**
- * @function hash
+ * @function compare_levels
  *
- * @brief Calculates hash of a string
- *
- * @discussion
- * <p>This function calculates hash value of the given string, and returns the hash value.
+ * @brief Compare the distances an engine found with the reference
  *
- * @param str is the string to calculate hash value
- * @return hash value of the given string
+ * @param e is the engines, found holds the distances of the engine
+ * @param ref is the reference of the case
+ * @param engine is the name of the engine
+ * @param start is the case id of the starting actor
+ * @param cap is the largest distance the engine can hold, larger distances are cut to it
+ * @param failure is set to the description of the first difference
+ * @return 0 if every distance is the same, 1 otherwise
  */
-long hash(char *str)
+static int compare_levels(struct CheckEngines *e, struct CheckReference *ref, char *engine, int start, int cap,
+                          char *failure)
 {
-    long hash_value;
-    long p_pow;
+    int expected;
     int i;
 
-    const int p = 31;
-    const long m = 10000000009;
-
-    hash_value = 0;
-    p_pow = 1;
-
-    for (i = 0; i < strlen(str); i++)
+    for (i = 0; i < e->g->actor_count; i++)
     {
-        hash_value = (hash_value + (int) str[i] * p_pow) % m;
-        p_pow = (p_pow * p) % m;
+        expected = (e->expected[i] > cap) ? cap : e->expected[i];
+
+        if (e->found[i] != expected)
+        {
+            snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s, %s from \"%.80s\": \"%.80s\" is at %d, expected %d",
+                     e->label, engine, ref->names[start], e->g->actor_names[i], e->found[i], expected);
+            return 1;
+        }
     }
 
-    return hash_value;
+    return 0;
 }
 
 
 /**
- * @function create_map_entry
+ * @function check_source
  *
- * @brief Initialize a new instance of struct MapEntry
+ * @brief Compare the distances of every BFS engine from an actor with the reference
  *
  * @discussion
- * <p>This function allocates memory for a new instance of struct MapEntry, then initializes
- * fields and returns a pointer to new instance.
+ * <p>reference_bfs must have been run from the actor.
  *
- * @param key is the value to access MapEntry
- * @param value is the pointer to original value to hold
- * @return pointer to MapEntry instance
+ * @param e is the engines
+ * @param ref is the reference of the case
+ * @param start is the case id of the starting actor
+ * @param failure is set to the description of the first difference
+ * @return 0 if every engine agrees with the reference, 1 otherwise
  */
-struct MapEntry *create_map_entry(long key, void *value)
+static int check_source(struct CheckEngines *e, struct CheckReference *ref, int start, char *failure)
 {
-    struct MapEntry *new_node;
+    struct Graph *g;
+    long histogram[UNREACHED];
+    long expected_histogram[UNREACHED];
+    long reached;
+    int levels;
+    int deepest;
+    int failed;
+    int kernel;
+    int id;
+    int i;
 
-    new_node = (struct MapEntry*) malloc(sizeof(struct MapEntry));
+    g = e->g;
+    id = e->ids[start];
+    reached = 0;
+    deepest = 0;
+    memset(expected_histogram, 0, sizeof(expected_histogram));
 
-    new_node->key = key;
-    new_node->value = value;
-    new_node->next = NULL;
+    for (i = 0; i < g->actor_count; i++)
+    {
+        if (e->expected[i] > 0)
+        {
+            reached++;
+        }
 
-    return new_node;
-}
+        if (e->expected[i] > deepest)
+        {
+            deepest = e->expected[i];
+        }
 
+        if (e->expected[i] >= 0 && e->expected[i] < UNREACHED)
+        {
+            expected_histogram[e->expected[i]]++;
+        }
+    }
 
-/**
- * @function build_hash_tables
- *
- * @brief Initialize Actor and Movie objects and insert them to HashTables
- *
- * @param lines is the array of string
- * @param line_count is the file's line count
- * @param movies is the pointer to movies hash table
- * @param actors is the pointer to actors hash table
- */
-void build_hash_tables(char **lines, int line_count, struct HashTable *movies, struct HashTable *actors)
-{
-    struct Movie *movie;
-    struct Actor *actor;
-    struct MapEntry *result;
-    char **tokens;
-    char *current;
-    int i;
-    int j;
+    failed = 0;
 
-    for (i = 0; i < line_count; i++)
+    /* Context kernels */
+    for (kernel = 0; kernel < 3 && !failed; kernel++)
     {
-        tokens = parse_line(lines[i]);
-        if (tokens[0] == NULL)
+        for (i = 0; i < g->actor_count; i++)
         {
-            continue;
+            e->found[i] = -1;
         }
 
-        /* Create a movie structure with a name */
-        movie = create_movie(tokens[0]);
-        j = 1;
-        current = tokens[j];
+        if (kernel == 0)
+        {
+            levels = bfs_levels(e->ctx, id);
+        }
+        else if (kernel == 1)
+        {
+            levels = bfs_levels_prefetch(e->ctx, id);
+        }
+        else
+        {
+            levels = expand_neighborhood(e->ctx, id, g->actor_count, NULL, start % 2, check_visit, e->found);
+        }
 
-        /* Traverse every actor */
-        while (current != NULL)
+        for (i = 0; i < g->actor_count && kernel < 2; i++)
         {
-            strcpy(movie->actors[j-1], current);
-            if (j >= movie->actor_count-1)
-            {
-                movie->actor_count += 1;
-                movie->actors = realloc(movie->actors, movie->actor_count * sizeof(char*));
-                movie->actors[movie->actor_count - 1] = malloc(MAX_INPUT * sizeof(char));
-            }
-            current = tokens[++j];
+            e->found[i] = (e->ctx->actor_stamps[i] == e->ctx->epoch) ? e->ctx->actor_level[i] : -1;
+        }
+
+        e->found[id] = 0;
+        failed = compare_levels(e, ref, kernel == 0 ? "bfs_levels" : kernel == 1 ? "bfs_levels_prefetch"
+                                                                                : "expand_neighborhood",
+                                start, INT32_MAX, failure);
+
+        if (!failed && levels != reached)
+        {
+            failed = 1;
+            snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s, kernel %d from \"%.80s\": %d actors reached, expected %ld",
+                     e->label, kernel, ref->names[start], levels, reached);
         }
+    }
 
-        movie->actor_count -= 1;
-        movie->actors = realloc(movie->actors, movie->actor_count * sizeof(char*));
+    if (!failed)
+    {
+        levels = (int) parallel_bfs(e->parallel, id);
+        memcpy(e->found, e->parallel->actor_level, g->actor_count * sizeof(int));
+        failed = compare_levels(e, ref, "parallel_bfs", start, INT32_MAX, failure);
+        kernel = 3;
+    }
 
-        /* Creating movie completed. Insert to hashtable */
-        insert(movies, hash(movie->name), movie);
+    if (!failed && levels == reached)
+    {
+        levels = (int) compact_bfs(e->compact, id);
 
-        /* Inserting into actors hashtable */
-        for (j = 0; j < movie->actor_count; j++)
+        for (i = 0; i < g->actor_count; i++)
         {
-            result = search(actors, hash(movie->actors[j]));
+            e->found[i] = (e->compact->distance[i] == UNREACHED) ? -1 : e->compact->distance[i];
+        }
 
-            if (result != NULL)
-            {
-                actor = result->value;
-                actor->movie_count++;
-                actor->movies = realloc(actor->movies, actor->movie_count * sizeof(char*));
-                actor->movies[actor->movie_count - 1] = malloc(MAX_INPUT * sizeof(char));
-                strcpy(actor->movies[actor->movie_count -1], movie->name);
-            }
-            else
-            {
-                actor = create_actor(movie->actors[j]);
-                insert(actors, hash(actor->name), actor);
-                actor->movies[actor->movie_count - 1] = malloc(MAX_INPUT * sizeof(char));
-                strcpy(actor->movies[actor->movie_count - 1], movie->name);
-            }
+        failed = compare_levels(e, ref, "compact_bfs", start, UNREACHED - 1, failure);
+        kernel = 4;
+    }
+
+    if (!failed && levels != reached)
+    {
+        failed = 1;
+        snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s, kernel %d from \"%.80s\": %d actors reached, expected %ld",
+                 e->label, kernel, ref->names[start], levels, reached);
+    }
+
+    /* Out of core sweep, distances above UNREACHED - 1 are not counted */
+    if (!failed)
+    {
+        id = external_find_actor(e->external, ref->names[start]);
+        levels = (id == -1) ? -1 : external_bacon_sweep(e->external, id, histogram);
+        failed = (levels != -1 && e->external->saturated != (deepest > UNREACHED - 1));
+        deepest = (deepest > UNREACHED - 1) ? UNREACHED - 1 : deepest;
+        failed = failed || (levels != deepest);
+
+        for (i = 0; i <= deepest && !failed; i++)
+        {
+            failed = (histogram[i] != expected_histogram[i]);
         }
 
-        free(tokens);
+        if (failed)
+        {
+            snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s, external_bacon_sweep from \"%.80s\": %d levels, "
+                     "expected %d, or a different histogram or saturation", e->label, ref->names[start], levels,
+                     deepest);
+        }
     }
+
+    return failed;
 }
 
 
 /**
- * @function insert
+ * @function check_pair
  *
- * @brief Insert element to hash table
+ * @brief Compare the distances and paths of every two actor engine with the reference
  *
- * @param ht is the hash table to operate on
- * @param key is the hash value
- * @param value is the pointer to original value
+ * @discussion
+ * <p>reference_bfs and reference_dijkstra must have been run from the starting actor. The strongest
+ * connection is not a shortest path, it is checked to be a valid path at least as long as the distance
+ * and to cost as much as the reference chain. A search limited
+ * to a few actors must give the distance or a lower bound of it.
+ *
+ * @param e is the engines
+ * @param ref is the reference of the case
+ * @param start is the case id of the starting actor
+ * @param end is the case id of the ending actor
+ * @param failure is set to the description of the first difference
+ * @return 0 if every engine agrees with the reference, 1 otherwise
  */
-void insert(struct HashTable *ht, long key, void *value)
+static int check_pair(struct CheckEngines *e, struct CheckReference *ref, int start, int end, char *failure)
 {
-    long i;
-    struct MapEntry *entry;
-
-    if (key < 0)
+    uint64_t count;
+    long paths;
+    long cost;
+    char *engine;
+    int expected;
+    int result;
+    int saved;
+    int hops;
+    int bacon;
+    int s;
+    int t;
+
+    s = e->ids[start];
+    t = e->ids[end];
+    expected = ref->level[end];
+    engine = NULL;
+
+    /* Legacy search on the hash tables, it knows names only */
+    saved = quiet_stdout(-1);
+    result = find_distance(ref->names[start], ref->names[end], e->movies, e->actors);
+    bacon = find_bacon_number(ref->names[start], e->movies, e->actors);
+    quiet_stdout(saved);
+
+    if (result != expected)
     {
-        key = -key;
+        engine = "find_distance";
+    }
+    else if (bacon != (ref->c->has_bacon ? ref->level[0] : -1))
+    {
+        engine = "find_bacon_number";
+        result = bacon;
+        expected = ref->c->has_bacon ? ref->level[0] : -1;
     }
+    else if (s != -1 && t != -1)
+    {
+        result = find_distance_filtered(e->ctx, s, t, NULL);
 
-    i = key % ht->table_size;
-    entry = create_map_entry(key, value);
+        if (result != expected || (result >= 0 && !check_parent_path(e, ref, s, t, result)))
+        {
+            engine = "find_distance_filtered";
+        }
+    }
 
-    if (ht[i].head == NULL)
+    if (engine == NULL && s != -1 && t != -1)
     {
-        ht[i].head = entry;
-        ht[i].count = 1;
+        if ((e->g->actor_components[s] == e->g->actor_components[t]) != (expected != -1))
+        {
+            engine = "actor_components";
+        }
+        else
+        {
+            set_search_limits(e->ctx, 0, 1 + (start + end) % 16, NULL);
+            result = find_distance_filtered(e->ctx, s, t, NULL);
+            set_search_limits(e->ctx, 0, 0, NULL);
+
+            if (result != expected &&
+                (result != SEARCH_STOPPED || e->ctx->lower_bound < 1 || e->ctx->lower_bound > expected))
+            {
+                engine = "find_distance_filtered with a node limit";
+                result = (result == SEARCH_STOPPED) ? (int) e->ctx->lower_bound : result;
+            }
+        }
     }
-    else
+
+    if (engine == NULL && s != -1 && t != -1)
     {
-        entry->next = ht[i].head;
-        ht[i].head = entry;
-        ht[i].count++;
-    }
-}
+        result = count_shortest_paths(e->ctx, s, t, NULL, &count);
 
+        if (result != expected)
+        {
+            engine = "count_shortest_paths";
+        }
+        else if (result >= 0 && count != ref->paths[end])
+        {
+            snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s, count_shortest_paths from \"%.80s\" to \"%.80s\": %"
+                     PRIu64 " paths, expected %" PRIu64, e->label, ref->names[start], ref->names[end], count,
+                     ref->paths[end]);
+            return 1;
+        }
+        else if (result >= 0 && count <= SELF_CHECK_PATH_LIMIT)
+        {
+            paths = check_cursor_paths(e, ref, s, t, result);
 
-/**
- * @function search
- *
- * @brief Search an element on the hash table
- *
- * @param ht is the hash table to operate on
- * @param key is the hash value of the searched value
- * @return pointer to map entry that has the same key or NULL
- */
-struct MapEntry *search(struct HashTable *ht, long key)
-{
-    long i;
-    struct MapEntry *head;
-    struct MapEntry *curr;
+            if (paths != (long) count)
+            {
+                engine = "path cursor";
+                result = (int) paths;
+                expected = (int) count;
+            }
+        }
+    }
 
-    if (key < 0)
+    if (engine == NULL && s != -1 && t != -1)
     {
-        key = -key;
+        cost = find_strongest_link(e->weighted, e->ctx, s, t, &hops);
+        result = (cost == -1) ? -1 : hops;
+
+        if ((cost == -1) != (expected == -1) ||
+            (cost != -1 && (hops < expected || !check_parent_path(e, ref, s, t, hops))))
+        {
+            engine = "find_strongest_link";
+        }
+        else if (cost != ref->cost[end])
+        {
+            engine = "find_strongest_link cost";
+            result = (int) cost;
+            expected = (int) ref->cost[end];
+        }
     }
 
-    i = key % ht->table_size;
-    head = ht[i].head;
-    curr = head;
-
-    while ((curr != NULL) && (curr->key != key))
+    if (engine != NULL)
     {
-        curr = curr->next;
+        snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s, %s from \"%.80s\" to \"%.80s\": %d, expected %d, or a wrong "
+                 "path", e->label, engine, ref->names[start], ref->names[end], result, expected);
     }
 
-    return curr;
-}
-
-
-/**
- * @function find_bacon_number
- *
- * @brief Find the distance of an actor to Kevin Bacon
- *
- * @param start is the name of the starting actor
- * @param movies is the movies hash table
- * @param actors is the actors hash table
- * @return distance value
- */
-int find_bacon_number(char *start, struct HashTable *movies, struct HashTable *actors)
-{
-    return find_distance(start, "Bacon, Kevin", movies, actors);
+    return engine != NULL;
 }
 
 
 /**
- * @function find_distance
+ * @function check_loaded
  *
- * @brief Find the distance of an actor to another
+ * @brief Load a case file and compare every engine with the reference
  *
- * @param start is the name of the starting actor
- * @param end is the name of the ending actor
- * @param movies is the movies hash table
- * @param actors is the actors hash table
- * @return distance value
+ * @param ref is the reference of the case
+ * @param path is the case file
+ * @param dir is the directory for the adjacency file
+ * @param label is the name of the loader path
+ * @param placement is the placement of the parallel BFS
+ * @param queries is the pairs of case ids to query, sorted by starting actor
+ * @param query_count is the number of pairs
+ * @param failure is set to the description of the first difference
+ * @return 0 if every engine agrees with the reference, 1 otherwise
  */
-int find_distance(char *start, char *end, struct HashTable *movies, struct HashTable *actors)
+static int check_loaded(struct CheckReference *ref, char *path, char *dir, char *label, int placement,
+                        int *queries, int query_count, char *failure)
 {
-    struct Queue *q;
-    struct MapEntry *tmp_map_entry;
-    struct Actor *s;
-    struct Actor *curr_actor;
-    struct Actor *next_actor;
-    struct Actor *tmp_actor;
-    struct Movie *curr_movie;
-    struct QueueNode *node;
-    char *v;
+    struct CheckEngines e;
+    struct LoadStats stats;
+    struct CheckCase *c;
+    char adjacency[MAX_STDIN_LEN];
+    int corrupt;
+    int present;
+    int failed;
+    int start;
+    int q;
     int i;
-    int j;
-    int num;
 
-    if ((search(actors, hash(start)) == NULL) || (search(actors, hash(end)) == NULL))
+    c = ref->c;
+    memset(&e, 0, sizeof(struct CheckEngines));
+    e.label = label;
+
+    if (load_file(path, &e.movies, &e.actors, &e.chunks, &stats) == -1)
     {
-        printf("Could not found one or two of actors in the table. Please check again.\n");
-        return -1;
+        snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s: could not load %s", label, path);
+        return 1;
     }
 
+    e.g = build_graph(e.movies, e.actors);
+    e.ids = malloc((c->actor_count + 1) * sizeof(int));
+    e.expected = malloc((e.g->actor_count + 1) * sizeof(int));
+    e.found = malloc((e.g->actor_count + 1) * sizeof(int));
 
-    q = create_queue();
-    enqueue(q, start);
-
-    tmp_map_entry = search(actors, hash(start)); // tmp can not be NULL
-    s = tmp_map_entry->value;
-    s->is_visited = 1;
+    /* Every written actor is loaded with its name, and nothing else is */
+    present = 0;
+    failed = (e.g->movie_count != c->line_count);
 
-    while (q->front != NULL)
+    for (i = 0; i <= c->actor_count && !failed; i++)
     {
-        node = (struct QueueNode *) dequeue(q);
-        v = node->value;
-
-        if (strcmp(v, end) == 0)
-        {
-            num = 0;
-            curr_actor = search(actors, hash(v))->value;
-            next_actor = curr_actor->parent;
-
-            while (curr_actor != NULL)
-            {
-                if (next_actor != NULL)
-                {
-                    printf("%s - %s: \"%s\"\n", curr_actor->name, next_actor->name, curr_actor->parent_movie_name);
-                    next_actor = next_actor->parent;
-                }
+        e.ids[i] = find_actor_id(e.actors, ref->names[i]);
+        present += (ref->present[i] > 0);
+        failed = (e.ids[i] == -1) == (ref->present[i] > 0) ||
+                 (e.ids[i] != -1 && strcmp(e.g->actor_names[e.ids[i]], ref->names[i]) != 0);
+    }
 
-                curr_actor = curr_actor->parent;
-                num++;
-            }
+    if (failed || present != e.g->actor_count)
+    {
+        failed = 1;
+        snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s: %d actors and %d movies loaded, expected %d and %d, or a "
+                 "name is wrong", label, e.g->actor_count, e.g->movie_count, present, c->line_count);
+    }
 
-            free(node);
+    if (!failed)
+    {
+        snprintf(adjacency, MAX_STDIN_LEN, "%s/case.adj", dir);
 
-            while (q->front != NULL)
-            {
-                node = dequeue(q);
-                free(node);
-            }
+        e.ctx = create_search_context(e.g);
+        e.compact = build_compact_graph(e.g);
+        e.parallel = create_parallel_bfs(e.g, 2, placement, 0);
+        e.weighted = create_weighted_graph(e.g);
 
-            free(q);
+        if (write_adjacency_file(e.g, adjacency, SELF_CHECK_BLOCK_SIZE) == 0)
+        {
+            e.external = open_external_graph(adjacency, &corrupt);
+        }
 
-            return num - 1;
+        if (e.external == NULL)
+        {
+            failed = 1;
+            snprintf(failure, SELF_CHECK_FAILURE_SIZE, "%s: could not write and open %s", label, adjacency);
         }
+    }
 
-        curr_actor = search(actors, hash(v))->value;
+    start = -1;
 
-        /* Search every not searched movie, add not visited actors to queue */
-        for (i = 0; i < curr_actor->movie_count; i++)
+    for (q = 0; q < query_count && !failed; q++)
+    {
+        if (queries[2 * q] != start)
         {
-            curr_movie = search(movies, hash(curr_actor->movies[i]))->value;
+            start = queries[2 * q];
+            reference_bfs(ref, start);
+            reference_dijkstra(ref, start);
 
-            if (curr_movie->is_visited == 0)
+            for (i = 0; i <= c->actor_count; i++)
             {
-                curr_movie->is_visited = 1;
-
-                for (j = 0; j < curr_movie->actor_count; j++)
+                if (e.ids[i] != -1)
                 {
-                    tmp_actor = search(actors, hash(curr_movie->actors[j]))->value;
-
-                    if (tmp_actor->is_visited == 0)
-                    {
-                        if (tmp_actor->parent == NULL)
-                        {
-                            tmp_actor->parent = curr_actor;
-                            strcpy(tmp_actor->parent_movie_name, curr_movie->name);
-                        }
-
-                        enqueue(q, tmp_actor->name);
-                    }
+                    e.expected[e.ids[i]] = ref->level[i];
                 }
             }
+
+            if (e.ids[start] != -1)
+            {
+                failed = check_source(&e, ref, start, failure);
+            }
         }
 
-        free(node);
+        if (!failed)
+        {
+            failed = check_pair(&e, ref, start, queries[2 * q + 1], failure);
+        }
     }
 
-    free(q);
+    if (e.external != NULL)
+    {
+        close_external_graph(e.external);
+        unlink(adjacency);
+    }
 
-    return -1;
+    if (e.ctx != NULL)
+    {
+        free_weighted_graph(e.weighted);
+        free_parallel_bfs(e.parallel);
+        free_compact_graph(e.compact);
+        free_search_context(e.ctx);
+    }
+
+    free(e.ids);
+    free(e.expected);
+    free(e.found);
+    free_graph(e.g);
+    free_hash_tables(e.movies, e.actors);
+    free_chunks(e.chunks);
+
+    return failed;
 }
 
 
 /**
- * @function create_queue_node
+ * @function check_case
  *
- * @brief creates a new node for queue
+ * @brief Run every loader path and engine on a case
  *
  * @discussion
- * <p>Function wraps a value with
- * necessary queue values and returns a pointer to it.
+ * <p>The case is tokenized with every delimiter scanner, then written plain and with every supported
+ * compression, and each file is loaded and checked with every engine.
  *
- * @see {@code struct Queue}
- * @see {@code struct QueueNode}
- *
- * @author Mert Turkmenoglu
- *
- * @param value is the pointer to original value
- * @return a pointer to wrapped instance
+ * @param c is the case
+ * @param dir is the directory to write files to
+ * @param queries is the pairs of case ids to query, sorted by starting actor
+ * @param query_count is the number of pairs
+ * @param failure is set to the description of the first difference
+ * @return 0 if every engine agrees with the reference, 1 otherwise
  */
-struct QueueNode* create_queue_node(void* value)
+int check_case(struct CheckCase *c, char *dir, int *queries, int query_count, char *failure)
 {
-    struct QueueNode *temp;
+    struct CheckReference *ref;
+    char path[MAX_STDIN_LEN];
+    char *text;
+    long size;
+    int failed;
+    int format;
+
+    static char *formats[] = {"plain", "gzip", "zstd"};
+    static char *suffixes[] = {"txt", "txt.gz", "txt.zst"};
+
+    ref = create_check_reference(c);
+    text = check_case_text(c, ref, &size);
+    failed = check_scanners(c, ref, text, size, failure);
+    free(text);
+
+    for (format = INPUT_PLAIN; format <= INPUT_ZSTD && !failed; format++)
+    {
+        snprintf(path, MAX_STDIN_LEN, "%s/case.%s", dir, suffixes[format]);
 
-    temp = (struct QueueNode *) malloc(sizeof(struct QueueNode));
+        /* Formats the program is built without are skipped */
+        if (write_check_case(c, ref, path, format) == -1)
+        {
+            if (format == INPUT_PLAIN)
+            {
+                failed = 1;
+                snprintf(failure, SELF_CHECK_FAILURE_SIZE, "could not write %s", path);
+            }
 
-    temp->value = value;
-    temp->next = NULL;
+            continue;
+        }
 
-    return temp;
+        failed = check_loaded(ref, path, dir, formats[format], format % 3, queries, query_count, failure);
+        unlink(path);
+    }
+
+    free_check_reference(ref);
+
+    return failed;
 }
 
 
 /**
- * @function create_queue
+ * @function same_failure
  *
- * @brief creates a struct Queue instance
+ * @brief Compare the loader path and engine of two failure descriptions
  *
  * @discussion
- * <p>Function allocates memory for a queue instance then
- * assigns front and rear pointers to NULL.
- *
- * @see {@code struct Queue}
- * @see {@code struct QueueNode}
- *
- * @author Mert Turkmenoglu
+ * <p>The signature of a failure is its text up to the first " from " or colon, the loader path and the
+ * engine or scanner that failed. Names and numbers after it change while a case is minimized.
  *
- * @return pointer to new created queue instance
+ * @param failure is the description of a failure
+ * @param first is the description of the first failure
+ * @return 1 if both have the same signature, 0 otherwise
  */
-struct Queue *create_queue()
+static int same_failure(char *failure, char *first)
 {
-    struct Queue *q;
+    char *from;
+    size_t length;
 
-    q = (struct Queue*) malloc(sizeof(struct Queue));
+    length = strcspn(first, ":");
+    from = strstr(first, " from ");
 
-    q->front = NULL;
-    q->rear = NULL;
+    if (from != NULL && (size_t) (from - first) < length)
+    {
+        length = (size_t) (from - first);
+    }
 
-    return q;
+    return strncmp(failure, first, length) == 0 &&
+           (failure[length] == ':' || strncmp(failure + length, " from ", 6) == 0);
 }
 
 
 /**
- * @function enqueue
+ * @function minimize_check_case
  *
- * @brief Adds new element to queue
+ * @brief Make a failing case as small as possible
  *
  * @discussion
- * <p>Function adds a new element to end of the queue.
- *
- * @see {@code struct Queue}
- * @see {@code struct QueueNode}
- *
- * @author Mert Turkmenoglu
+ * <p>Blocks of lines are removed while the case still fails, halving the block size down to single
+ * lines, then single cast entries, then name padding. This is repeated until nothing can be removed
+ * or SELF_CHECK_TRIALS cases are checked. Queries are kept, so an actor the failure depends on stays.
+ * A smaller case is kept only if it fails the same way as the first, so minimizing does not wander off
+ * to another bug.
  *
- * @param q is the queue instance to operate on
- * @param value is the pointer to new element to add queue
+ * @param c is the failing case
+ * @param dir is the directory to write files to
+ * @param queries is the pairs of case ids to query
+ * @param query_count is the number of pairs
+ * @param first is the description of the failure of c
+ * @return the smallest failing case found, to be freed by the caller
  */
-void enqueue(struct Queue *q, void *value)
+struct CheckCase *minimize_check_case(struct CheckCase *c, char *dir, int *queries, int query_count, char *first)
 {
-    struct QueueNode *temp;
+    struct CheckCase *best;
+    struct CheckCase *candidate;
+    char failure[SELF_CHECK_FAILURE_SIZE];
+    int progress;
+    int trials;
+    int size;
+    int i;
 
-    temp = create_queue_node(value);
+    best = copy_check_case(c, 0, 0, -1);
+    trials = 0;
+    progress = 1;
 
-    if (q->rear == NULL)
+    while (progress && trials < SELF_CHECK_TRIALS)
     {
-        q->front = temp;
-        q->rear = temp;
-        return;
+        progress = 0;
+
+        for (size = best->line_count / 2; size >= 1 && trials < SELF_CHECK_TRIALS; size /= 2)
+        {
+            for (i = 0; i < best->line_count && trials < SELF_CHECK_TRIALS; trials++)
+            {
+                candidate = copy_check_case(best, i, size, -1);
+
+                if (check_case(candidate, dir, queries, query_count, failure) && same_failure(failure, first))
+                {
+                    free_check_case(best);
+                    best = candidate;
+                    progress = 1;
+                }
+                else
+                {
+                    free_check_case(candidate);
+                    i += size;
+                }
+            }
+        }
+
+        for (i = 0; i < best->line_offsets[best->line_count] && trials < SELF_CHECK_TRIALS; trials++)
+        {
+            candidate = copy_check_case(best, 0, 0, i);
+
+            if (check_case(candidate, dir, queries, query_count, failure) && same_failure(failure, first))
+            {
+                free_check_case(best);
+                best = candidate;
+                progress = 1;
+            }
+            else
+            {
+                free_check_case(candidate);
+                i++;
+            }
+        }
+
+        if (best->name_padding > 0)
+        {
+            candidate = copy_check_case(best, 0, 0, -1);
+            candidate->name_padding = 0;
+            trials++;
+
+            if (check_case(candidate, dir, queries, query_count, failure) && same_failure(failure, first))
+            {
+                free_check_case(best);
+                best = candidate;
+                progress = 1;
+            }
+            else
+            {
+                free_check_case(candidate);
+            }
+        }
     }
 
-    q->rear->next = temp;
-    q->rear = temp;
+    return best;
 }
 
 
 /**
- * @function dequeue
+ * @function self_check
  *
- * @brief deques element
+ * @brief Compare every engine and loader path with a reference BFS on generated inputs
  *
  * @discussion
- * <p> Function removes the first element of the queue
- * and returns the element. If it is empty, returns NULL.
- *
- * @see {@code struct Queue}
- * @see {@code struct QueueNode}
- *
- * @author Mert Turkmenoglu
+ * <p>Every round generates a case of the next shape, picks starting actors (Bacon, Kevin or the first
+ * actor, and random ones) and ending actors (the same, plus a name not in the file), and runs
+ * check_case. On the first failure the case is minimized and written next to the other files of the
+ * self check as repro.txt, and its directory is kept. A seed reproduces the same cases.
  *
- * @param q is the queue instance to operate on
- * @return the first element of the queue
+ * @param rounds is the number of cases
+ * @param seed is the seed of the generator
+ * @return EXIT_SUCCESS if every case passes, EXIT_FAILURE otherwise
  */
-void *dequeue(struct Queue *q)
+int self_check(int rounds, uint64_t seed)
 {
-    void *temp;
+    struct CheckCase *c;
+    struct CheckCase *small;
+    struct CheckReference *ref;
+    char dir[] = SELF_CHECK_DIR;
+    char path[MAX_STDIN_LEN];
+    char failure[SELF_CHECK_FAILURE_SIZE];
+    int queries[2 * SELF_CHECK_SOURCES * SELF_CHECK_TARGETS];
+    int targets[SELF_CHECK_TARGETS];
+    long query_total;
+    uint64_t state;
+    int failed;
+    int round;
+    int source;
+    int i;
+    int j;
 
-    if (q->front == NULL)
+    static char *shapes[] = {"random", "hub", "components", "duplicates", "long lines", "no bacon", "chain"};
+
+    if (mkdtemp(dir) == NULL)
     {
-        return NULL;
+        fprintf(stderr, "Could not create a directory from %s\n", SELF_CHECK_DIR);
+        return EXIT_FAILURE;
     }
 
-    temp = q->front;
-    q->front = q->front->next;
+    printf("Self check: %d cases, seed %" PRIu64 ", files in %s\n", rounds, seed, dir);
 
-    if (q->front == NULL)
+    state = seed * 2 + 1;
+    failed = 0;
+    query_total = 0;
+
+    for (round = 0; round < rounds && !failed; round++)
     {
-        q->rear = NULL;
+        c = generate_check_case(&state, round % SHAPE_COUNT);
+
+        targets[0] = 0;
+        targets[1] = c->actor_count;
+        for (j = 2; j < SELF_CHECK_TARGETS; j++)
+        {
+            targets[j] = next_random(&state, c->actor_count);
+        }
+
+        for (i = 0; i < SELF_CHECK_SOURCES; i++)
+        {
+            source = (i == 0) ? 0 : next_random(&state, c->actor_count);
+
+            for (j = 0; j < SELF_CHECK_TARGETS; j++)
+            {
+                queries[2 * (i * SELF_CHECK_TARGETS + j)] = source;
+                queries[2 * (i * SELF_CHECK_TARGETS + j) + 1] = targets[j];
+            }
+        }
+
+        failed = check_case(c, dir, queries, SELF_CHECK_SOURCES * SELF_CHECK_TARGETS, failure);
+        query_total += SELF_CHECK_SOURCES * SELF_CHECK_TARGETS;
+
+        if (failed)
+        {
+            printf("FAILED on case %d (%s, %d lines): %s\n", round, shapes[round % SHAPE_COUNT], c->line_count,
+                   failure);
+            printf("Minimizing...\n");
+
+            small = minimize_check_case(c, dir, queries, SELF_CHECK_SOURCES * SELF_CHECK_TARGETS, failure);
+            check_case(small, dir, queries, SELF_CHECK_SOURCES * SELF_CHECK_TARGETS, failure);
+
+            ref = create_check_reference(small);
+            snprintf(path, MAX_STDIN_LEN, "%s/repro.txt", dir);
+
+            if (write_check_case(small, ref, path, INPUT_PLAIN) == 0)
+            {
+                printf("Reproducer with %d lines: %s\n", small->line_count, path);
+                printf("It fails with: %s\n", failure);
+            }
+
+            free_check_reference(ref);
+            free_check_case(small);
+        }
+
+        free_check_case(c);
     }
 
-    return temp;
+    if (failed)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("All %d cases passed, %ld queries on each loader path\n", rounds, query_total);
+    rmdir(dir);
+
+    return EXIT_SUCCESS;
 }